@@ -37,50 +37,42 @@ void BTreeNode::save() {
 
 // Get the record and turn it into a block ID.
 BlockID BTreeNode::get_block_id(RecordID record_id) const {
-    Dbt *dbt = this->block->get(record_id);
-    BlockID block_id = *(BlockID *) dbt->get_data();
-    delete dbt;
-    return block_id;
+    RecordView data = this->block->view(record_id);
+    return *(const BlockID *) data.get_data();
 }
 
 // Get the record and turn it into a Handle.
 Handle BTreeNode::get_handle(RecordID record_id) const {
-    Dbt *dbt = this->block->get(record_id);
-    BlockID handle_block_id = *(BlockID *) dbt->get_data();
-    RecordID handle_record_id = *(RecordID *) ((char *) dbt->get_data() + sizeof(BlockID));
-    delete dbt;
+    RecordView data = this->block->view(record_id);
+    BlockID handle_block_id = *(const BlockID *) data.get_data();
+    RecordID handle_record_id = *(const RecordID *) (data.get_data() + sizeof(BlockID));
     return Handle(handle_block_id, handle_record_id);
 }
 
 // Get the record and turn it into a KeyValue.
 KeyValue *BTreeNode::get_key(RecordID record_id) const {
-    Dbt *dbt = this->block->get(record_id);
-    char *bytes = (char *) dbt->get_data();
+    const char *bytes = this->block->view(record_id).get_data();
     KeyValue *key_value = new KeyValue();
     Value value;
     uint offset = 0;
     for (auto const &data_type: this->key_profile) {
         value.data_type = data_type;
         if (data_type == ColumnAttribute::DataType::INT) {
-            value.n = *(int32_t *) (bytes + offset);
+            value.n = *(const int32_t *) (bytes + offset);
             offset += sizeof(int32_t);
         } else if (data_type == ColumnAttribute::DataType::TEXT) {
-            uint16_t size = *(uint16_t *) (bytes + offset);
+            uint16_t size = *(const uint16_t *) (bytes + offset);
             offset += sizeof(uint16_t);
-            char buffer[DbBlock::BLOCK_SZ];
-            memcpy(buffer, bytes + offset, size);
-            buffer[size] = '\0';
-            value.s = std::string(buffer);  // assume ascii for now
+            value.s.assign(bytes + offset, size);  // assume ascii for now
             offset += size;
         } else if (data_type == ColumnAttribute::DataType::BOOLEAN) {
-            value.n = *(uint8_t *) (bytes + offset);
+            value.n = *(const uint8_t *) (bytes + offset);
             offset += sizeof(uint8_t);
         } else {
             throw DbRelationError("Only know how to unmarshal INT, TEXT, or BOOLEAN");
         }
         key_value->push_back(value);
     }
-    delete dbt;
     return key_value;
 }
 
@@ -103,14 +95,15 @@ Dbt *BTreeNode::marshal_handle(Handle handle) {
 
 // Convert KeyValue into bytes.
 Dbt *BTreeNode::marshal_key(const KeyValue *key) {
-    char *bytes = new char[DbBlock::BLOCK_SZ]; // more than we need
+    uint block_size = this->file.get_block_size();
+    char *bytes = new char[block_size]; // more than we need
     uint offset = 0;
     uint col_num = 0;
     for (auto const &data_type: this->key_profile) {
         Value value = (*key)[col_num];
 
         if (data_type == ColumnAttribute::DataType::INT) {
-            if (offset + 4 > DbBlock::BLOCK_SZ - 4)
+            if (offset + 4 > block_size - 4)
                 throw DbRelationError("index key too big to marshal");
 
             *(int32_t *) (bytes + offset) = value.n;
@@ -120,7 +113,7 @@ Dbt *BTreeNode::marshal_key(const KeyValue *key) {
             u_long size = (uint16_t) value.s.length();
             if (size > UINT16_MAX)
                 throw DbRelationError("text field too long to marshal");
-            if (offset + 2 + size > DbBlock::BLOCK_SZ)
+            if (offset + 2 + size > block_size)
                 throw DbRelationError("index key too big to marshal");
 
             *(uint16_t *) (bytes + offset) = (uint16_t) size;
@@ -129,7 +122,7 @@ Dbt *BTreeNode::marshal_key(const KeyValue *key) {
             offset += size;
 
         } else if (data_type == ColumnAttribute::DataType::BOOLEAN) {
-            if (offset + 1 > DbBlock::BLOCK_SZ - 1)
+            if (offset + 1 > block_size - 1)
                 throw DbRelationError("index key too big to marshal");
 
             *(uint8_t *) (bytes + offset) = (uint8_t) value.n;
@@ -195,9 +188,7 @@ void BTreeStat::save() {
 BTreeInterior::BTreeInterior(HeapFile &file, BlockID block_id, const KeyProfile &key_profile, bool create) : BTreeNode(
         file, block_id, key_profile, create), first(0), pointers(), boundaries() {
     if (!create) {
-        RecordIDs *record_id_list = this->block->ids();
-        RecordID i = 1;
-        for (auto j = record_id_list->size(); j > 0; j--) {
+        for (RecordID i: this->block->live_ids()) {
             if (i == 1) {
                 // first pointer
                 this->first = get_block_id(i);
@@ -209,9 +200,7 @@ BTreeInterior::BTreeInterior(HeapFile &file, BlockID block_id, const KeyProfile
                 KeyValue *key_value = get_key(i);
                 this->boundaries.push_back(key_value);
             }
-            i++;
         }
-        delete record_id_list;
     }
 }
 
@@ -360,20 +349,18 @@ BTreeLeaf::BTreeLeaf(HeapFile &file, BlockID block_id, const KeyProfile &key_pro
                                                                                                      next_leaf(0),
                                                                                                      key_map() {
     if (!create) {
-        RecordIDs *record_id_list = this->block->ids();
-        RecordID i = 1;
-        for (auto j = record_id_list->size(); j > 0; j--) {
-            if (i == record_id_list->size()) {
+        RecordID last = this->block->size();
+        for (RecordID i: this->block->live_ids()) {
+            if (i == last) {
                 // next leaf block
                 this->next_leaf = get_block_id(i);
             } else if (i % 2 == 0) {
                 // record i-1: handle, record i: key
                 KeyValue *key_value = get_key(i);
                 this->key_map[*key_value] = get_handle(i - 1);
+                delete key_value;
             }
-            i++;
         }
-        delete record_id_list;
     }
 }
 
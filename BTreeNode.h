@@ -30,7 +30,7 @@ public:
     BlockID get_id() const { return this->id; }
 
 protected:
-    SlottedPage *block;
+    DbBlock *block;
     HeapFile &file;
     BlockID id;
     const KeyProfile &key_profile;
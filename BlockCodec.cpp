@@ -0,0 +1,182 @@
+/**
+ * @file BlockCodec.cpp
+ * @see Seattle University, CPSC5300
+ */
+#include <cstring>
+#include <map>
+#include <vector>
+#include "BlockCodec.h"
+
+using namespace std;
+typedef uint8_t u8;
+typedef uint32_t u32;
+
+/**
+ * The codecs that find() knows about, by id.
+ */
+static map<u8, const BlockCodec *> &codecs() {
+    static map<u8, const BlockCodec *> all{{BlockCodec::lz().get_id(), &BlockCodec::lz()}};
+    return all;
+}
+
+/**
+ * The built-in codec.
+ * @return  the one LzCodec
+ */
+const BlockCodec &BlockCodec::lz() {
+    static LzCodec codec;
+    return codec;
+}
+
+/**
+ * Look up a codec by the id kept with the blocks it compressed.
+ * @param id
+ * @return    the codec, or nullptr if there isn't one with that id
+ */
+const BlockCodec *BlockCodec::find(u8 id) {
+    auto it = codecs().find(id);
+    return it == codecs().end() ? nullptr : it->second;
+}
+
+/**
+ * Let find() find another codec.
+ * @param codec  the codec (kept by the caller for as long as any file uses it)
+ */
+void BlockCodec::add(const BlockCodec *codec) {
+    if (codec->get_id() == 0)
+        throw DbRelationError("codec id 0 is for blocks that aren't compressed");
+    codecs()[codec->get_id()] = codec;
+}
+
+/**
+ * Get four bytes that may not be aligned.
+ */
+static u32 read32(const u8 *p) {
+    u32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+u32 LzCodec::compress(const char *block, u32 size, char *out, u32 capacity) const {
+    const u8 *in = (const u8 *) block;
+    u8 *to = (u8 *) out;
+    const u8 *end = to + capacity;
+    vector<u32> last_seen(1 << HASH_BITS, 0);  // where each hash was last seen, plus one (0 for never)
+    u32 anchor = 0;  // first byte not yet written out
+    u32 pos = 0;
+    while (pos + MIN_MATCH <= size) {
+        u32 sequence = read32(in + pos);
+        u32 hash = (sequence * 2654435761U) >> (32 - HASH_BITS);
+        u32 candidate = last_seen[hash];
+        last_seen[hash] = pos + 1;
+        if (candidate == 0 || pos - (candidate - 1) > MAX_OFFSET || read32(in + candidate - 1) != sequence) {
+            pos++;
+            continue;
+        }
+        u32 match = candidate - 1;
+        u32 length = MIN_MATCH;
+        while (pos + length < size && in[match + length] == in[pos + length])
+            length++;
+        if (!emit(to, end, in + anchor, pos - anchor, pos - match, length))
+            return 0;
+        pos += length;
+        anchor = pos;
+    }
+    if (!emit(to, end, in + anchor, size - anchor, 0, 0))
+        return 0;
+    return (u32) (to - (u8 *) out);
+}
+
+void LzCodec::decompress(const char *in, u32 in_size, char *block, u32 size) const {
+    const u8 *from = (const u8 *) in;
+    const u8 *from_end = from + in_size;
+    u8 *to = (u8 *) block;
+    u8 *to_end = to + size;
+    while (from < from_end) {
+        u8 token = *from++;
+        u32 literal_count = token >> 4;
+        if (literal_count == 15)
+            literal_count += get_count(from, from_end);
+        if (literal_count > (u32) (from_end - from) || literal_count > (u32) (to_end - to))
+            throw DbRelationError("compressed block is corrupt");
+        memcpy(to, from, literal_count);
+        from += literal_count;
+        to += literal_count;
+        if (from == from_end)
+            break;  // the last sequence has no match
+        if (from_end - from < 2)
+            throw DbRelationError("compressed block is corrupt");
+        u32 offset = from[0] | (u32) from[1] << 8;
+        from += 2;
+        u32 match_length = token & 15;
+        if (match_length == 15)
+            match_length += get_count(from, from_end);
+        match_length += MIN_MATCH;
+        if (offset == 0 || offset > (u32) (to - (u8 *) block) || match_length > (u32) (to_end - to))
+            throw DbRelationError("compressed block is corrupt");
+        for (u32 i = 0; i < match_length; i++, to++)
+            *to = *(to - offset);  // one at a time, since the match can run into the bytes it is making
+    }
+    if (to != to_end)
+        throw DbRelationError("compressed block is corrupt");
+}
+
+/**
+ * Write one sequence.
+ * @param out            where to write it (moved past it)
+ * @param end            end of the room for it
+ * @param literals       bytes to write as they are
+ * @param literal_count  how many
+ * @param offset         how far back the match is
+ * @param match_length   how long it is (0 for the last sequence, which has no match)
+ * @return               false if there isn't room
+ */
+bool LzCodec::emit(u8 *&out, const u8 *end, const u8 *literals, u32 literal_count, u32 offset,
+                   u32 match_length) {
+    u32 match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+    if (out == end)
+        return false;
+    *out++ = (u8) ((literal_count < 15 ? literal_count : 15) << 4 | (match_code < 15 ? match_code : 15));
+    if (literal_count >= 15 && !put_count(out, end, literal_count - 15))
+        return false;
+    if (literal_count > (u32) (end - out))
+        return false;
+    memcpy(out, literals, literal_count);
+    out += literal_count;
+    if (match_length == 0)
+        return true;
+    if (end - out < 2)
+        return false;
+    *out++ = (u8) offset;
+    *out++ = (u8) (offset >> 8);
+    return match_code < 15 || put_count(out, end, match_code - 15);
+}
+
+/**
+ * Write the rest of a count that didn't fit in its four bits of the token.
+ * @return  false if there isn't room
+ */
+bool LzCodec::put_count(u8 *&out, const u8 *end, u32 count) {
+    for (;; count -= 255) {
+        if (out == end)
+            return false;
+        *out++ = (u8) (count < 255 ? count : 255);
+        if (count < 255)
+            return true;
+    }
+}
+
+/**
+ * Read the rest of a count that didn't fit in its four bits of the token.
+ */
+u32 LzCodec::get_count(const u8 *&in, const u8 *end) {
+    u32 count = 0;
+    u8 byte;
+    do {
+        if (in == end)
+            throw DbRelationError("compressed block is corrupt");
+        byte = *in++;
+        count += byte;
+    } while (byte == 255);
+    return count;
+}
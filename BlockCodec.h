@@ -0,0 +1,88 @@
+/**
+ * @file BlockCodec.h - Compression for the blocks of a CompressedFile.
+ * BlockCodec
+ * LzCodec: BlockCodec
+ *
+ * @see "Seattle University, CPSC5300, Spring 2022"
+ */
+#pragma once
+
+#include "storage_engine.h"
+
+/**
+ * @class BlockCodec - a way of compressing blocks
+ *
+ * Each codec has an id, which is kept with every block it compresses, so a block is always decompressed
+ * with the codec it was compressed with (whatever codec the file is writing with now). Codecs are found by
+ * id with find(); LzCodec is always there, and others can be added with add(). Id 0 is for blocks that
+ * are kept as they are, because compressing them didn't make them any smaller.
+ */
+class BlockCodec {
+public:
+    virtual ~BlockCodec() {}
+
+    /**
+     * The id kept with the blocks this codec compresses.
+     * @return  1 to 255
+     */
+    virtual u_int8_t get_id() const = 0;
+
+    /**
+     * Compress a block.
+     * @param block     the block
+     * @param size      its size
+     * @param out       where to put the compressed bytes
+     * @param capacity  room in out
+     * @return          number of compressed bytes, or 0 if they won't fit in out
+     */
+    virtual u_int32_t compress(const char *block, u_int32_t size, char *out, u_int32_t capacity) const = 0;
+
+    /**
+     * Decompress a block.
+     * @param in       the compressed bytes
+     * @param in_size  how many
+     * @param block    where to put the block
+     * @param size     the block's size
+     * @throws DbRelationError if the bytes don't decompress to exactly size bytes
+     */
+    virtual void decompress(const char *in, u_int32_t in_size, char *block, u_int32_t size) const = 0;
+
+    static const BlockCodec &lz();
+
+    static const BlockCodec *find(u_int8_t id);
+
+    static void add(const BlockCodec *codec);
+};
+
+/**
+ * @class LzCodec - fast LZ77 compression, with sequences laid out as in the LZ4 block format
+ *
+ * Each sequence is a token byte (count of literals in the high four bits, match length - MIN_MATCH in the
+ * low four, 15 meaning more bytes of the count follow, 255 at a time), the literals, and the match as a
+ * two-byte little-endian offset back into the block. The last sequence is just literals. Matches are found
+ * with a hash of the next four bytes, looking only at the last place they were seen, which is what makes
+ * it fast: text with a lot of repeats (what our archive tables are full of) shrinks several-fold, while
+ * random bytes are given up on quickly.
+ */
+class LzCodec : public BlockCodec {
+public:
+    virtual u_int8_t get_id() const { return ID; }
+
+    virtual u_int32_t compress(const char *block, u_int32_t size, char *out, u_int32_t capacity) const;
+
+    virtual void decompress(const char *in, u_int32_t in_size, char *block, u_int32_t size) const;
+
+    static const u_int8_t ID = 1;
+
+protected:
+    static const u_int32_t MIN_MATCH = 4;
+    static const u_int32_t MAX_OFFSET = 65535;
+    static const u_int32_t HASH_BITS = 12;
+
+    static bool emit(u_int8_t *&out, const u_int8_t *end, const u_int8_t *literals, u_int32_t literal_count,
+                     u_int32_t offset, u_int32_t match_length);
+
+    static bool put_count(u_int8_t *&out, const u_int8_t *end, u_int32_t count);
+
+    static u_int32_t get_count(const u_int8_t *&in, const u_int8_t *end);
+};
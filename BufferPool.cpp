@@ -0,0 +1,270 @@
+/**
+ * @file BufferPool.cpp
+ * @see Seattle University, CPSC5300
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "BufferPool.h"
+
+using namespace std;
+typedef uint32_t u32;
+
+/**
+ * Constructor
+ * @param size  number of bytes (rounded up to a multiple of ALIGNMENT)
+ */
+AlignedBuffer::AlignedBuffer(size_t size) : bytes(nullptr), length(size) {
+    void *memory = nullptr;
+    if (posix_memalign(&memory, ALIGNMENT, (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT) != 0)
+        throw std::bad_alloc();
+    this->bytes = (char *) memory;
+}
+
+AlignedBuffer::~AlignedBuffer() {
+    free(this->bytes);
+}
+
+/**
+ * BufferFrame constructor
+ * @param pool        the pool the frame belongs to
+ * @param block_size  size of the blocks it can hold
+ */
+BufferFrame::BufferFrame(BufferPool &pool, u32 block_size) : pool(pool), io(nullptr), block_id(0),
+                                                             data(block_size), pin_count(0), dirty(false),
+                                                             referenced(false) {
+}
+
+/**
+ * The DbBlock using the frame is done with it.
+ */
+void BufferFrame::unpin() {
+    if (this->pin_count > 0)
+        this->pin_count--;
+}
+
+/**
+ * Write a batch of blocks out. A file that can have many writes going at once should override this; by
+ * default they are just written one at a time.
+ * @param writes  the blocks, in block order
+ */
+void PageIO::write_pages(const vector<PageWrite> &writes) {
+    for (auto const &page: writes)
+        write_page(page.block_id, page.data, page.size);
+}
+
+/**
+ * Constructor
+ * @param budget  how many bytes of frames to keep
+ */
+BufferPool::BufferPool(size_t budget) : budget(budget), used(0), frames(), frame_map(), hand(0), hits(0),
+                                        misses(0), evictions(0) {
+}
+
+/**
+ * Destructor. Dirty blocks of files that are still open are written back, in case they were never flushed.
+ */
+BufferPool::~BufferPool() {
+    for (BufferFrame *frame : this->frames) {
+        if (frame->io != nullptr && frame->dirty) {
+            try {
+                write(frame);
+            } catch (DbException &e) {
+                // nothing more can be done for it this late
+            }
+        }
+        delete frame;
+    }
+}
+
+BufferPool &BufferPool::shared() {
+    static BufferPool pool;
+    return pool;
+}
+
+/**
+ * Get a block into a frame and pin it there.
+ * @param io          the block's file
+ * @param block_id    which block
+ * @param block_size  the file's block size
+ * @param is_new      true if the block isn't in the file yet (the frame is just zeroed)
+ * @return            the pinned frame; caller hands it to the DbBlock that uses it, or unpins it
+ */
+BufferFrame *BufferPool::pin(PageIO *io, BlockID block_id, u32 block_size, bool is_new) {
+    auto found = this->frame_map.find(make_pair(io, block_id));
+    if (found != this->frame_map.end()) {
+        BufferFrame *frame = found->second;
+        this->hits++;
+        frame->pin_count++;
+        frame->referenced = true;
+        return frame;
+    }
+    this->misses++;
+    BufferFrame *frame = make_room(block_size);
+    if (frame == nullptr) {
+        frame = new BufferFrame(*this, block_size);
+        this->frames.push_back(frame);
+        this->used += block_size;
+    }
+    if (is_new) {
+        memset(frame->get_data(), 0, block_size);
+    } else {
+        io->read_page(block_id, frame->get_data(), block_size);  // if this throws, the frame is just left empty
+    }
+    frame->io = io;
+    frame->block_id = block_id;
+    frame->pin_count = 1;
+    frame->dirty = false;
+    frame->referenced = true;
+    this->frame_map[make_pair(io, block_id)] = frame;
+    return frame;
+}
+
+/**
+ * Pin a block's frame, but only if the block is already in the pool.
+ * @param io        the block's file
+ * @param block_id  which block
+ * @return          the pinned frame, or nullptr if the block isn't in the pool (nothing is read)
+ */
+BufferFrame *BufferPool::find(PageIO *io, BlockID block_id) {
+    auto found = this->frame_map.find(make_pair(io, block_id));
+    if (found == this->frame_map.end())
+        return nullptr;
+    BufferFrame *frame = found->second;
+    this->hits++;
+    frame->pin_count++;
+    frame->referenced = true;
+    return frame;
+}
+
+/**
+ * Write back all the dirty blocks of a file, in block order, as one batch.
+ * @param io  the file
+ */
+void BufferPool::flush(PageIO *io) {
+    vector<BufferFrame *> dirty;
+    for (BufferFrame *frame : this->frames)
+        if (frame->io == io && frame->dirty)
+            dirty.push_back(frame);
+    if (dirty.empty())
+        return;
+    sort(dirty.begin(), dirty.end(), [](const BufferFrame *a, const BufferFrame *b) {
+        return a->block_id < b->block_id;
+    });
+    vector<PageWrite> writes;
+    writes.reserve(dirty.size());
+    for (BufferFrame *frame : dirty)
+        writes.push_back(PageWrite{frame->block_id, frame->get_data(), frame->get_size()});
+    io->write_pages(writes);
+    for (BufferFrame *frame : dirty)
+        frame->dirty = false;
+}
+
+/**
+ * Forget all the blocks of a file (without writing them back). Frames that are still pinned are let go
+ * of once they are unpinned.
+ * @param io  the file
+ */
+void BufferPool::discard(PageIO *io) {
+    for (size_t i = 0; i < this->frames.size();) {
+        BufferFrame *frame = this->frames[i];
+        if (frame->io != io) {
+            i++;
+            continue;
+        }
+        this->frame_map.erase(make_pair(io, frame->block_id));
+        frame->io = nullptr;
+        frame->dirty = false;
+        if (frame->pin_count == 0)
+            remove(frame);  // moves the last frame into slot i
+        else
+            i++;
+    }
+}
+
+/**
+ * Change the memory budget, evicting blocks if it went down.
+ * @param budget  how many bytes of frames to keep
+ */
+void BufferPool::set_budget(size_t budget) {
+    this->budget = budget;
+    while (this->used > this->budget) {
+        BufferFrame *victim = next_victim();
+        if (victim == nullptr)
+            break;
+        if (victim->io != nullptr) {
+            if (victim->dirty)
+                write(victim);
+            this->frame_map.erase(make_pair(victim->io, victim->block_id));
+            this->evictions++;
+        }
+        remove(victim);
+    }
+}
+
+/**
+ * Evict blocks until there is room in the budget for another block.
+ * @param block_size  size of the block that needs a frame
+ * @return            an evicted frame of just the right size to use, or nullptr to make a new one
+ */
+BufferFrame *BufferPool::make_room(u32 block_size) {
+    while (this->used + block_size > this->budget) {
+        BufferFrame *victim = next_victim();
+        if (victim == nullptr)
+            break;  // everything is pinned, so go over budget
+        if (victim->io != nullptr) {
+            if (victim->dirty)
+                write(victim);
+            this->frame_map.erase(make_pair(victim->io, victim->block_id));
+            victim->io = nullptr;
+            this->evictions++;
+        }
+        if (victim->get_size() == block_size)
+            return victim;
+        remove(victim);
+    }
+    return nullptr;
+}
+
+/**
+ * Run the clock hand around to an unpinned frame that hasn't been used since the hand last went by.
+ * @return  the frame, or nullptr if they are all pinned
+ */
+BufferFrame *BufferPool::next_victim() {
+    size_t n = this->frames.size();
+    for (size_t tries = 0; tries < 2 * n; tries++) {
+        if (this->hand >= n)
+            this->hand = 0;
+        BufferFrame *frame = this->frames[this->hand++];
+        if (frame->pin_count > 0)
+            continue;
+        if (frame->referenced && frame->io != nullptr) {
+            frame->referenced = false;  // second chance
+            continue;
+        }
+        return frame;
+    }
+    return nullptr;
+}
+
+/**
+ * Delete a frame that isn't holding anything.
+ * @param frame  an unpinned frame with no block in it
+ */
+void BufferPool::remove(BufferFrame *frame) {
+    auto it = std::find(this->frames.begin(), this->frames.end(), frame);
+    *it = this->frames.back();
+    this->frames.pop_back();
+    this->used -= frame->get_size();
+    delete frame;
+}
+
+/**
+ * Write a block back to its file.
+ * @param frame  frame holding the block
+ */
+void BufferPool::write(BufferFrame *frame) {
+    frame->io->write_page(frame->block_id, frame->get_data(), frame->get_size());
+    frame->dirty = false;
+}
@@ -0,0 +1,185 @@
+/**
+ * @file BufferPool.h - Buffer pool shared by all the HeapFiles.
+ * AlignedBuffer
+ * PageIO
+ * BufferFrame: BlockPin
+ * BufferPool
+ *
+ * @see "Seattle University, CPSC5300, Spring 2022"
+ */
+#pragma once
+
+#include "db_cxx.h"
+#include "storage_engine.h"
+
+class BufferPool;
+
+/**
+ * @class AlignedBuffer - memory aligned for direct I/O (O_DIRECT needs the buffer, the file offset and the
+ * length all to be multiples of the device's block size; ALIGNMENT covers every device we run on).
+ */
+class AlignedBuffer {
+public:
+    static const size_t ALIGNMENT = 4096;
+
+    explicit AlignedBuffer(size_t size);
+
+    virtual ~AlignedBuffer();
+
+    AlignedBuffer(const AlignedBuffer &other) = delete;
+
+    AlignedBuffer &operator=(const AlignedBuffer &other) = delete;
+
+    char *data() const { return bytes; }
+
+    size_t size() const { return length; }
+
+protected:
+    char *bytes;
+    size_t length;
+};
+
+/**
+ * A block to be written by PageIO::write_pages().
+ */
+struct PageWrite {
+    BlockID block_id;
+    const char *data;
+    u_int32_t size;
+};
+
+/**
+ * @class PageIO - where the blocks in BufferPool frames come from and go back to (a file).
+ */
+class PageIO {
+public:
+    virtual ~PageIO() {}
+
+    /**
+     * Read a block into memory.
+     * @param block_id  which block
+     * @param data      where to put it
+     * @param size      the block size
+     */
+    virtual void read_page(BlockID block_id, char *data, u_int32_t size) = 0;
+
+    /**
+     * Write a block out.
+     * @param block_id  which block
+     * @param data      the block's memory
+     * @param size      the block size
+     */
+    virtual void write_page(BlockID block_id, const char *data, u_int32_t size) = 0;
+
+    virtual void write_pages(const std::vector<PageWrite> &writes);
+};
+
+/**
+ * @class BufferFrame - one block's memory in the BufferPool.
+ * A DbBlock given a frame's memory keeps the frame pinned (so it can't be evicted) until the DbBlock is
+ * deleted. Changes made through the DbBlock are in the frame right away; the frame just has to be marked
+ * dirty so they get written back.
+ */
+class BufferFrame : public BlockPin {
+public:
+    BufferFrame(BufferPool &pool, u_int32_t block_size);
+
+    virtual ~BufferFrame() {}
+
+    BufferFrame(const BufferFrame &other) = delete;
+
+    BufferFrame &operator=(const BufferFrame &other) = delete;
+
+    virtual void mark_dirty() { dirty = true; }
+
+    virtual void unpin();
+
+    char *get_data() { return data.data(); }
+
+    u_int32_t get_size() const { return (u_int32_t) data.size(); }
+
+protected:
+    BufferPool &pool;
+    PageIO *io;  // nullptr if the frame isn't holding any file's block
+    BlockID block_id;
+    AlignedBuffer data;
+    u_int32_t pin_count;
+    bool dirty;
+    bool referenced;  // for the clock
+
+    friend class BufferPool;
+};
+
+/**
+ * @class BufferPool - page frames for the blocks of all the open files.
+ *
+ * A block is read from its file into a frame the first time it is asked for and stays there, so later
+ * requests for it cost nothing, until its frame is needed for some other block. Which frame to give up is
+ * picked by the clock algorithm, skipping any that are pinned. Dirty blocks are only written back when
+ * they are evicted or their file is flushed (or, for any left over, when the pool goes away).
+ *
+ * The frames take up no more than the memory budget, unless every frame is pinned, in which case the pool
+ * grows rather than failing. Frames are sized for the blocks they hold, so files with different block
+ * sizes can share the pool. The frames are aligned, so a file opened for direct I/O can read into them.
+ *
+ * Blocks are known by the PageIO of their file, so a file must be flushed and discarded from the pool
+ * before it is closed.
+ */
+class BufferPool {
+public:
+    static const size_t DEFAULT_BUDGET = 16 * 1024 * 1024;
+
+    BufferPool(size_t budget = DEFAULT_BUDGET);
+
+    virtual ~BufferPool();
+
+    BufferPool(const BufferPool &other) = delete;
+
+    BufferPool &operator=(const BufferPool &other) = delete;
+
+    /**
+     * The pool shared by all the HeapFiles.
+     * @return the pool
+     */
+    static BufferPool &shared();
+
+    virtual BufferFrame *pin(PageIO *io, BlockID block_id, u_int32_t block_size, bool is_new = false);
+
+    virtual BufferFrame *find(PageIO *io, BlockID block_id);
+
+    virtual void flush(PageIO *io);
+
+    virtual void discard(PageIO *io);
+
+    virtual void set_budget(size_t budget);
+
+    size_t get_budget() const { return budget; }
+
+    size_t get_used() const { return used; }
+
+    u_int64_t get_hits() const { return hits; }
+
+    u_int64_t get_misses() const { return misses; }
+
+    u_int64_t get_evictions() const { return evictions; }
+
+    void reset_counters() { hits = misses = evictions = 0; }
+
+protected:
+    size_t budget;
+    size_t used;
+    std::vector<BufferFrame *> frames;
+    std::map<std::pair<PageIO *, BlockID>, BufferFrame *> frame_map;
+    size_t hand;
+    u_int64_t hits;
+    u_int64_t misses;
+    u_int64_t evictions;
+
+    virtual BufferFrame *make_room(u_int32_t block_size);
+
+    virtual BufferFrame *next_victim();
+
+    virtual void remove(BufferFrame *frame);
+
+    virtual void write(BufferFrame *frame);
+};
@@ -0,0 +1,188 @@
+/**
+ * @file CompressedFile.cpp
+ * @see Seattle University, CPSC5300
+ */
+#include <cstring>
+#include <sys/stat.h>
+#include "CompressedFile.h"
+
+using namespace std;
+typedef uint32_t u32;
+
+/**
+ * Constructor
+ * @param name
+ * @param block_size         size of the blocks if the file gets created
+ * @param column_attributes  layout of the records, needed to read PaxPage blocks (kept by the caller)
+ * @param pax                true to use PaxPage blocks if the file gets created
+ * @param free_space_map     true to keep a FreeSpaceMap for append() to use
+ * @param codec              how to compress the blocks that get written (kept by the caller)
+ * @param pool               where the file's blocks are cached
+ */
+CompressedFile::CompressedFile(string name, u32 block_size, const ColumnAttributes *column_attributes, bool pax,
+                               bool free_space_map, const BlockCodec &codec, BufferPool &pool)
+        : HeapFile(name, block_size, column_attributes, pax, free_space_map, pool), codec(codec), stored() {
+    this->dbfilename = this->name + ".zdb";
+}
+
+/**
+ * Read a block from the file and decompress it.
+ * @param block_id
+ * @param data      where to put it
+ * @param size      the block size
+ */
+void CompressedFile::read_page(BlockID block_id, char *data, u32 size) {
+    u32 record_size = read_stored(block_id);
+    decode(this->stored.data(), record_size, data, size);
+}
+
+/**
+ * Compress a block and write it to the file (as it is, if compressing it doesn't make it any smaller).
+ * @param block_id
+ * @param data      the block
+ * @param size      the block size
+ */
+void CompressedFile::write_page(BlockID block_id, const char *data, u32 size) {
+    this->stored.resize(sizeof(StoredHeader) + size);
+    StoredHeader *header = (StoredHeader *) this->stored.data();
+    memset(header, 0, sizeof(StoredHeader));
+    header->block_size = size;
+    header->codec = this->codec.get_id();
+    char *body = this->stored.data() + sizeof(StoredHeader);
+    u32 body_size = this->codec.compress(data, size, body, size - 1);
+    if (body_size == 0) {
+        header->codec = 0;
+        memcpy(body, data, size);
+        body_size = size;
+    }
+    Dbt key(&block_id, sizeof(block_id));
+    Dbt record(this->stored.data(), sizeof(StoredHeader) + body_size);
+    this->db->put(nullptr, &key, &record, 0);
+}
+
+/**
+ * Read a run of blocks in order, get_read_ahead() compressed blocks at a time.
+ * @param range  blocks to read (any past the last block are skipped)
+ * @return       the scan (freed by caller, before the file is closed)
+ */
+BlockScan *CompressedFile::scan(BlockIDRange range) {
+    range = range.subrange(1, this->last);
+    if (this->read_ahead > 1 && !range.empty())
+        return new CompressedBlockScan(*this, range, this->read_ahead);
+    return new BlockScan(*this, range);
+}
+
+/**
+ * Check if a table has a CompressedFile.
+ * @param name  the file's name
+ * @return      true if <name>.zdb is there
+ */
+bool CompressedFile::exists(string name) {
+    struct stat st;
+    return ::stat(env_path(name + ".zdb").c_str(), &st) == 0;
+}
+
+/**
+ * Open the Berkeley DB file (and create it, depending on the flags). Unlike in HeapFile, the records
+ * aren't a fixed length, so the block size of an existing file comes from its first block.
+ * @param flags  Berkeley DB flags
+ */
+void CompressedFile::db_open(uint flags) {
+    if (!this->closed)
+        return;
+    this->db = new Db(_DB_ENV, 0);
+    try {
+        this->db->open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags, 0644);
+
+        this->last = this->allocated = flags ? 0 : get_block_count();
+        vector<char> first;
+        Dbt data;
+        if (this->last > 0) {
+            u32 record_size = read_stored(1);
+            if (record_size < sizeof(StoredHeader))
+                throw DbRelationError(this->dbfilename + " is not a CompressedFile");
+            this->block_size = ((StoredHeader *) this->stored.data())->block_size;
+            first.resize(this->block_size);
+            decode(this->stored.data(), record_size, first.data(), this->block_size);
+            data = Dbt(first.data(), this->block_size);
+        }
+        opened(this->last > 0 ? &data : nullptr);
+    } catch (...) {
+        db_close();
+        throw;
+    }
+    reclaim_tail();
+}
+
+/**
+ * Add an extent of empty blocks to the end of the file (they compress down to next to nothing).
+ */
+void CompressedFile::preallocate() {
+    init_empty_block();
+    for (u32 i = 0; i < EXTENT_BLOCKS; i++)
+        write_page(++this->allocated, this->empty_block.data(), this->block_size);
+}
+
+/**
+ * Get a block's record from Berkeley DB into the stored buffer.
+ * @param block_id
+ * @return          the record's size
+ */
+u32 CompressedFile::read_stored(BlockID block_id) {
+    this->stored.resize(sizeof(StoredHeader) + (this->closed ? DbBlock::MAX_BLOCK_SZ : this->block_size));
+    Dbt key(&block_id, sizeof(block_id));
+    Dbt record(this->stored.data(), (u32) this->stored.size());
+    record.set_ulen((u32) this->stored.size());
+    record.set_flags(DB_DBT_USERMEM);
+    this->db->get(nullptr, &key, &record, 0);
+    return record.get_size();
+}
+
+/**
+ * Get a block back out of its record.
+ * @param record       the record
+ * @param record_size  its size
+ * @param data         where to put the block
+ * @param size         the block size
+ */
+void CompressedFile::decode(const char *record, u32 record_size, char *data, u32 size) {
+    const StoredHeader *header = (const StoredHeader *) record;
+    if (record_size < sizeof(StoredHeader) || header->block_size != size)
+        throw DbRelationError(this->dbfilename + " has a block that isn't " + to_string(size) + " bytes");
+    const char *body = record + sizeof(StoredHeader);
+    u32 body_size = record_size - (u32) sizeof(StoredHeader);
+    if (header->codec == 0) {
+        if (body_size != size)
+            throw DbRelationError(this->dbfilename + " has a block that is cut short");
+        memcpy(data, body, size);
+        return;
+    }
+    const BlockCodec *block_codec = BlockCodec::find(header->codec);
+    if (block_codec == nullptr)
+        throw DbRelationError(this->dbfilename + " has a block compressed with unknown codec " +
+                              to_string(header->codec));
+    block_codec->decompress(body, body_size, data, size);
+}
+
+/**
+ * Constructor
+ * @param file        the file to read
+ * @param range       which of its blocks (not empty)
+ * @param read_ahead  how many blocks to get from Berkeley DB at a time
+ */
+CompressedBlockScan::CompressedBlockScan(CompressedFile &file, BlockIDRange range, u32 read_ahead)
+        : BulkBlockScan(file, range, read_ahead), compressed_file(file), block(file.block_size) {
+}
+
+/**
+ * Decompress one of the records in the bulk buffer.
+ * @param data      the record
+ * @param block_id  its block id
+ * @return          the block (freed by caller, before calling next() again)
+ */
+DbBlock *CompressedBlockScan::unpack(Dbt &data, BlockID block_id) {
+    this->compressed_file.decode((const char *) data.get_data(), data.get_size(), this->block.data(),
+                                 (u32) this->block.size());
+    Dbt block_data(this->block.data(), (u32) this->block.size());
+    return this->compressed_file.make_block(block_data, block_id);
+}
@@ -0,0 +1,85 @@
+/**
+ * @file CompressedFile.h - HeapFile whose blocks are compressed on disk.
+ * CompressedFile: HeapFile
+ * CompressedBlockScan: BulkBlockScan
+ *
+ * @see "Seattle University, CPSC5300, Spring 2022"
+ */
+#pragma once
+
+#include "HeapFile.h"
+#include "BlockCodec.h"
+
+/**
+ * @class CompressedFile - heap file that keeps each block compressed, for cold tables that are mostly scanned
+ *
+ * Like HeapFile, there is one Berkeley DB RecNo record per block, but the records are as long as the
+ * compressed blocks are rather than all block_size long. Blocks are compressed by write_page() and
+ * decompressed by read_page(), so in the BufferPool (and everywhere else) they are ordinary blocks; only
+ * the bytes on disk, and the I/O to get at them, are smaller. Scans get the compressed records out of
+ * Berkeley DB in bulk and decompress them one at a time without putting them in the pool.
+ *
+ * Each record starts with a StoredHeader saying the block size and which BlockCodec compressed it (0 for
+ * a block that compressing didn't make any smaller, kept as it is).
+ */
+class CompressedFile : public HeapFile {
+public:
+    CompressedFile(std::string name, u_int32_t block_size = DbBlock::BLOCK_SZ,
+                   const ColumnAttributes *column_attributes = nullptr, bool pax = false,
+                   bool free_space_map = false, const BlockCodec &codec = BlockCodec::lz(),
+                   BufferPool &pool = BufferPool::shared());
+
+    virtual ~CompressedFile() {}
+
+    CompressedFile(const CompressedFile &other) = delete;
+
+    CompressedFile(CompressedFile &&temp) = delete;
+
+    CompressedFile &operator=(const CompressedFile &other) = delete;
+
+    CompressedFile &operator=(CompressedFile &&temp) = delete;
+
+    virtual void read_page(BlockID block_id, char *data, u_int32_t size);
+
+    virtual void write_page(BlockID block_id, const char *data, u_int32_t size);
+
+    virtual BlockScan *scan(BlockIDRange range);
+
+    static bool exists(std::string name);
+
+protected:
+    struct StoredHeader {
+        u_int32_t block_size;
+        u_int8_t codec;  // BlockCodec id, or 0 for not compressed
+        u_int8_t unused[3];
+    };
+
+    const BlockCodec &codec;
+    std::vector<char> stored;  // room for one record
+
+    virtual void db_open(uint flags = 0);
+
+    virtual void preallocate();
+
+    virtual u_int32_t read_stored(BlockID block_id);
+
+    virtual void decode(const char *record, u_int32_t record_size, char *data, u_int32_t size);
+
+    friend class CompressedBlockScan;
+};
+
+/**
+ * @class CompressedBlockScan - BulkBlockScan that decompresses each block as it gets to it
+ */
+class CompressedBlockScan : public BulkBlockScan {
+public:
+    CompressedBlockScan(CompressedFile &file, BlockIDRange range, u_int32_t read_ahead);
+
+    virtual ~CompressedBlockScan() {}
+
+protected:
+    CompressedFile &compressed_file;
+    std::vector<char> block;  // the block next() last returned
+
+    virtual DbBlock *unpack(Dbt &data, BlockID block_id);
+};
@@ -0,0 +1,350 @@
+/**
+ * @file DirectFile.cpp
+ * @see Seattle University, CPSC5300
+ */
+#include <aio.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "DirectFile.h"
+
+using namespace std;
+typedef uint32_t u32;
+
+/**
+ * Constructor
+ * @param name
+ * @param block_size         size of the blocks if the file gets created
+ * @param column_attributes  layout of the records, needed to read PaxPage blocks (kept by the caller)
+ * @param pax                true to use PaxPage blocks if the file gets created
+ * @param free_space_map     true to keep a FreeSpaceMap for append() to use
+ * @param pool               where the file's blocks are cached
+ */
+DirectFile::DirectFile(string name, u32 block_size, const ColumnAttributes *column_attributes, bool pax,
+                       bool free_space_map, BufferPool &pool)
+        : HeapFile(name, block_size, column_attributes, pax, free_space_map, pool), fd(-1), direct(false) {
+    this->dbfilename = path(name);
+}
+
+DirectFile::~DirectFile() {
+    close();
+}
+
+/**
+ * Delete the physical file.
+ */
+void DirectFile::drop(void) {
+    release_tail();
+    this->pool.discard(this);  // no point writing them back
+    close();
+    if (::unlink(this->dbfilename.c_str()) != 0)
+        fail("unlink");
+    if (this->free_space != nullptr)
+        this->free_space->drop();
+}
+
+/**
+ * Write the file's blocks out of the buffer pool, sync it to disk and close it.
+ */
+void DirectFile::close(void) {
+    if (this->closed)
+        return;
+    release_tail();
+    this->pool.flush(this);
+    this->pool.discard(this);
+    write_header();
+    ::fsync(this->fd);
+    ::close(this->fd);
+    this->fd = -1;
+    if (this->free_space != nullptr)
+        this->free_space->close();
+    this->closed = true;
+}
+
+/**
+ * Sync the file to disk, once its blocks have been written out of the buffer pool.
+ */
+void DirectFile::sync(void) {
+    write_header();
+    ::fdatasync(this->fd);
+}
+
+/**
+ * Read a block from the file into a buffer pool frame.
+ * @param block_id
+ * @param data      where to put it (aligned)
+ * @param size      the block size
+ */
+void DirectFile::read_page(BlockID block_id, char *data, u32 size) {
+    if (block_id > this->allocated)
+        throw DbRelationError(this->name + " has no block " + to_string(block_id));
+    read_at((off_t) block_id * size, data, size);
+}
+
+/**
+ * Write a block to the file. A block that isn't in aligned memory (one that isn't from the buffer pool) is
+ * copied to some first.
+ * @param block_id
+ * @param data      the block
+ * @param size      the block size
+ */
+void DirectFile::write_page(BlockID block_id, const char *data, u32 size) {
+    if ((uintptr_t) data % AlignedBuffer::ALIGNMENT == 0) {
+        write_at((off_t) block_id * size, data, size);
+    } else {
+        AlignedBuffer aligned(size);
+        memcpy(aligned.data(), data, size);
+        write_at((off_t) block_id * size, aligned.data(), size);
+    }
+}
+
+/**
+ * Write a batch of blocks (a flush of the buffer pool) with asynchronous I/O: up to WRITE_BATCH writes are
+ * handed to the kernel at once with lio_listio(), so the disk can have them all going together, and then
+ * their completions are checked. Blocks that aren't in aligned memory are written with write_page().
+ * @param writes  the blocks, in block order
+ */
+void DirectFile::write_pages(const vector<PageWrite> &writes) {
+    size_t batch = WRITE_BATCH;
+    long limit = ::sysconf(_SC_AIO_LISTIO_MAX);
+    if (limit > 0 && (size_t) limit < batch)
+        batch = (size_t) limit;
+    vector<struct aiocb> requests;
+    vector<struct aiocb *> list;
+    for (size_t start = 0; start < writes.size(); start += batch) {
+        requests.assign(min(batch, writes.size() - start), aiocb());
+        list.clear();
+        for (size_t i = 0; i < requests.size(); i++) {
+            const PageWrite &page = writes[start + i];
+            if ((uintptr_t) page.data % AlignedBuffer::ALIGNMENT != 0) {
+                write_page(page.block_id, page.data, page.size);
+                continue;
+            }
+            struct aiocb &request = requests[i];
+            request.aio_fildes = this->fd;
+            request.aio_offset = (off_t) page.block_id * page.size;
+            request.aio_buf = (void *) page.data;
+            request.aio_nbytes = page.size;
+            request.aio_lio_opcode = LIO_WRITE;
+            list.push_back(&request);
+        }
+        if (list.empty())
+            continue;
+        if (::lio_listio(LIO_WAIT, list.data(), (int) list.size(), nullptr) != 0 && errno != EIO)
+            fail("lio_listio");  // EIO just means some of them failed, which is checked for below
+        for (struct aiocb *request: list) {
+            int error = ::aio_error(request);
+            ssize_t n = ::aio_return(request);
+            if (error != 0 || (size_t) n != request->aio_nbytes) {
+                errno = error != 0 ? error : EIO;
+                fail("aio_write");
+            }
+        }
+    }
+}
+
+/**
+ * Read a run of blocks in order, get_read_ahead() blocks at a time.
+ * @param range  blocks to read (any past the last block are skipped)
+ * @return       the scan (freed by caller, before the file is closed)
+ */
+BlockScan *DirectFile::scan(BlockIDRange range) {
+    range = range.subrange(1, this->last);
+    if (this->read_ahead > 1 && !range.empty())
+        return new DirectBlockScan(*this, range, this->read_ahead);
+    return new BlockScan(*this, range);
+}
+
+/**
+ * Check if a table has a DirectFile.
+ * @param name  the file's name
+ * @return      true if <name>.direct is there
+ */
+bool DirectFile::exists(string name) {
+    struct stat st;
+    return ::stat(path(name).c_str(), &st) == 0;
+}
+
+/**
+ * Open the file (and create it, depending on the flags).
+ * @param flags  Berkeley DB flags: DB_CREATE and DB_EXCL mean the same as O_CREAT and O_EXCL
+ */
+void DirectFile::db_open(uint flags) {
+    if (!this->closed)
+        return;
+    int open_flags = O_RDWR;
+    if (flags & DB_CREATE)
+        open_flags |= O_CREAT;
+    if (flags & DB_EXCL)
+        open_flags |= O_EXCL;
+    this->direct = true;
+    this->fd = ::open(this->dbfilename.c_str(), open_flags | O_DIRECT, 0644);
+    if (this->fd < 0 && errno == EINVAL) {
+        this->direct = false;  // file system can't do it, so go through the page cache after all
+        this->fd = ::open(this->dbfilename.c_str(), open_flags, 0644);
+    }
+    if (this->fd < 0)
+        fail("open");
+
+    try {
+        AlignedBuffer buffer(AlignedBuffer::ALIGNMENT);
+        ssize_t n = ::pread(this->fd, buffer.data(), buffer.size(), 0);
+        if (n < 0)
+            fail("pread");
+        Header *header = (Header *) buffer.data();
+        if (n == 0) {
+            this->allocated = 0;
+        } else {
+            if ((size_t) n < sizeof(Header) || header->magic != MAGIC)
+                throw DbRelationError(this->dbfilename + " is not a DirectFile");
+            this->block_size = header->block_size;  // an existing file keeps the block size it was created with
+            this->allocated = get_block_count();
+        }
+        if (this->block_size % AlignedBuffer::ALIGNMENT != 0 && this->direct)
+            throw DbRelationError(this->dbfilename + ": block size " + to_string(this->block_size) +
+                                  " can't be read with O_DIRECT");
+        if (n == 0)
+            write_header();
+        this->last = this->allocated;
+
+        AlignedBuffer first(this->block_size);
+        Dbt data(first.data(), this->block_size);
+        if (this->last > 0)
+            read_at(this->block_size, first.data(), this->block_size);
+        opened(this->last > 0 ? &data : nullptr);
+    } catch (...) {
+        ::close(this->fd);
+        this->fd = -1;
+        throw;
+    }
+    reclaim_tail();
+}
+
+/**
+ * Number of blocks in the file, as kept in its header (the header is read again, since blocks past the
+ * last one in use don't count for anything until the file is opened).
+ * @return number of blocks
+ */
+uint32_t DirectFile::get_block_count() {
+    AlignedBuffer buffer(AlignedBuffer::ALIGNMENT);
+    if (::pread(this->fd, buffer.data(), buffer.size(), 0) < (ssize_t) sizeof(Header))
+        return 0;
+    return ((Header *) buffer.data())->allocated;
+}
+
+/**
+ * Add an extent of empty blocks to the end of the file, with one write.
+ */
+void DirectFile::preallocate() {
+    init_empty_block();
+    AlignedBuffer extent((size_t) EXTENT_BLOCKS * this->block_size);
+    for (u32 i = 0; i < EXTENT_BLOCKS; i++)
+        memcpy(extent.data() + (size_t) i * this->block_size, this->empty_block.data(), this->block_size);
+    write_at((off_t) (this->allocated + 1) * this->block_size, extent.data(), extent.size());
+    this->allocated += EXTENT_BLOCKS;
+    write_header();
+}
+
+/**
+ * Write block 0, the file's header.
+ */
+void DirectFile::write_header() {
+    AlignedBuffer buffer(this->block_size);
+    memset(buffer.data(), 0, buffer.size());
+    Header *header = (Header *) buffer.data();
+    header->magic = MAGIC;
+    header->block_size = this->block_size;
+    header->allocated = this->allocated;
+    write_at(0, buffer.data(), buffer.size());
+}
+
+/**
+ * Read all of some bytes from the file.
+ * @param offset  where in the file (aligned)
+ * @param data    where to put them (aligned)
+ * @param size    how many (aligned)
+ */
+void DirectFile::read_at(off_t offset, char *data, size_t size) {
+    ssize_t n = ::pread(this->fd, data, size, offset);
+    if (n < 0)
+        fail("pread");
+    if ((size_t) n != size)
+        throw DbRelationError(this->dbfilename + " is cut short at offset " + to_string(offset + n));
+}
+
+/**
+ * Write all of some bytes to the file.
+ * @param offset  where in the file (aligned)
+ * @param data    the bytes (aligned)
+ * @param size    how many (aligned)
+ */
+void DirectFile::write_at(off_t offset, const char *data, size_t size) {
+    ssize_t n = ::pwrite(this->fd, data, size, offset);
+    if (n < 0 || (size_t) n != size)
+        fail("pwrite");
+}
+
+/**
+ * Where a table's DirectFile is: in the database environment's home directory, like the Berkeley DB files.
+ * @param name  the file's name
+ * @return      the path
+ */
+string DirectFile::path(string name) {
+    return env_path(name + ".direct");
+}
+
+/**
+ * Report a failed system call the way Berkeley DB would.
+ * @param what  the call
+ * @throws DbException
+ */
+void DirectFile::fail(string what) {
+    int error = errno;
+    throw DbException((this->dbfilename + ": " + what + ": " + strerror(error)).c_str(), error);
+}
+
+/**
+ * Constructor
+ * @param file        the file to read
+ * @param range       which of its blocks (not empty)
+ * @param read_ahead  how many blocks to read at a time
+ */
+DirectBlockScan::DirectBlockScan(DirectFile &file, BlockIDRange range, u32 read_ahead)
+        : BlockScan(file, range, read_ahead), direct_file(file), buffer((size_t) read_ahead * file.block_size),
+          buffered_first(0), buffered_count(0) {
+}
+
+/**
+ * Get the next block.
+ * @return  the block (freed by caller), or nullptr when there are no more
+ */
+DbBlock *DirectBlockScan::next() {
+    if (this->next_id > this->last_id)
+        return nullptr;
+    if (this->next_id >= this->buffered_first + this->buffered_count)
+        fill();
+    BlockID block_id = this->next_id++;
+    DbBlock *block = pooled(block_id);
+    if (block == nullptr) {
+        Dbt data(this->buffer.data() + (size_t) (block_id - this->buffered_first) * this->direct_file.block_size,
+                 this->direct_file.block_size);
+        block = this->direct_file.make_block(data, block_id);
+    }
+    return block;
+}
+
+/**
+ * Read the next read_ahead blocks (or what is left of the range) into the buffer.
+ */
+void DirectBlockScan::fill() {
+    u32 count = this->last_id - this->next_id + 1;
+    if (count > this->read_ahead)
+        count = this->read_ahead;
+    u32 block_size = this->direct_file.block_size;
+    this->direct_file.read_at((off_t) this->next_id * block_size, this->buffer.data(), (size_t) count * block_size);
+    this->buffered_first = this->next_id;
+    this->buffered_count = count;
+}
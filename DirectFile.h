@@ -0,0 +1,116 @@
+/**
+ * @file DirectFile.h - HeapFile kept in one flat file and read with O_DIRECT.
+ * DirectFile: HeapFile
+ * DirectBlockScan: BlockScan
+ *
+ * @see "Seattle University, CPSC5300, Spring 2022"
+ */
+#pragma once
+
+#include "HeapFile.h"
+
+/**
+ * @class DirectFile - heap file whose blocks are in a plain file, <name>.direct, opened with O_DIRECT
+ *
+ * Block n is at offset n * block_size. Reads and writes go straight between the disk and the BufferPool's
+ * frames (which are aligned for it), skipping the operating system's page cache, so the BufferPool is the
+ * only cache the blocks are in and its budget is all the memory they use. Everything else (get(), put(),
+ * append(), the FreeSpaceMap) works just as in HeapFile; only read_page() and write_page() are different,
+ * and a flush of the buffer pool writes its blocks with asynchronous I/O, many at once (write_pages()).
+ *
+ * Block 0 is the file's header: a magic number, the block size and the number of blocks in the file. The
+ * file grows EXTENT_BLOCKS blocks at a time, with one write. If the file system doesn't do O_DIRECT
+ * (tmpfs, for one), the file is opened the usual way instead and is_direct() says so.
+ */
+class DirectFile : public HeapFile {
+public:
+    DirectFile(std::string name, u_int32_t block_size = DbBlock::BLOCK_SZ,
+               const ColumnAttributes *column_attributes = nullptr, bool pax = false, bool free_space_map = false,
+               BufferPool &pool = BufferPool::shared());
+
+    virtual ~DirectFile();
+
+    DirectFile(const DirectFile &other) = delete;
+
+    DirectFile(DirectFile &&temp) = delete;
+
+    DirectFile &operator=(const DirectFile &other) = delete;
+
+    DirectFile &operator=(DirectFile &&temp) = delete;
+
+    virtual void drop(void);
+
+    virtual void close(void);
+
+    virtual void read_page(BlockID block_id, char *data, u_int32_t size);
+
+    virtual void write_page(BlockID block_id, const char *data, u_int32_t size);
+
+    virtual void write_pages(const std::vector<PageWrite> &writes);
+
+    virtual BlockScan *scan(BlockIDRange range);
+
+    /**
+     * Check if the file really was opened with O_DIRECT.
+     * @return false if the file system wouldn't do it
+     */
+    virtual bool is_direct() const { return direct; }
+
+    static bool exists(std::string name);
+
+protected:
+    static const u_int32_t MAGIC = 0x54435244;  // "DRCT"
+    static const u_int32_t WRITE_BATCH = 64;    // most writes write_pages() has going at once
+
+    struct Header {
+        u_int32_t magic;
+        u_int32_t block_size;
+        u_int32_t allocated;
+    };
+
+    int fd;
+    bool direct;
+
+    virtual void db_open(uint flags = 0);
+
+    virtual uint32_t get_block_count();
+
+    virtual void preallocate();
+
+    virtual void write_header();
+
+    virtual void sync(void);
+
+    virtual void read_at(off_t offset, char *data, size_t size);
+
+    virtual void write_at(off_t offset, const char *data, size_t size);
+
+    static std::string path(std::string name);
+
+    virtual void fail(std::string what);
+
+    friend class DirectBlockScan;
+};
+
+/**
+ * @class DirectBlockScan - BlockScan that reads read_ahead blocks of a DirectFile at a time, with one read.
+ *
+ * As with BulkBlockScan, a block that is in the buffer pool is used from there, and the rest are used right
+ * where they are in the scan's own buffer and are not put in the pool.
+ */
+class DirectBlockScan : public BlockScan {
+public:
+    DirectBlockScan(DirectFile &file, BlockIDRange range, u_int32_t read_ahead);
+
+    virtual ~DirectBlockScan() {}
+
+    virtual DbBlock *next();
+
+protected:
+    DirectFile &direct_file;
+    AlignedBuffer buffer;
+    BlockID buffered_first;   // block at the start of the buffer
+    u_int32_t buffered_count;  // how many blocks are in the buffer
+
+    virtual void fill();
+};
@@ -87,38 +87,79 @@ EvalPlan *EvalPlan::optimize() {
 }
 
 ValueDicts *EvalPlan::evaluate() {
-    ValueDicts *ret = nullptr;
+    EvalRows *rows = stream();
+    ValueDicts *ret = new ValueDicts();
+    try {
+        for (Row *row = rows->next(); row != nullptr; row = rows->next()) {
+            ret->push_back(rows->to_value_dict(*row));
+            delete row;
+        }
+    } catch (...) {
+        delete rows;
+        for (auto row: *ret)
+            delete row;
+        delete ret;
+        throw;
+    }
+    delete rows;
+    return ret;
+}
+
+EvalRows *EvalPlan::stream() {
     if (this->type != ProjectAll && this->type != Project)
         throw DbRelationError("Invalid evaluation plan--not ending with a projection");
 
     EvalPipeline pipeline = this->relation->pipeline();
-    DbRelation *temp_table = pipeline.first;
-    Handles *handles = pipeline.second;
-    if (this->type == ProjectAll)
-        ret = temp_table->project(handles);
-    else if (this->type == Project)
-        ret = temp_table->project(handles, this->projection);
-    delete handles;
-    return ret;
+    return new EvalRows(*pipeline.first, pipeline.second, this->type == Project ? this->projection : nullptr);
 }
 
 EvalPipeline EvalPlan::pipeline() {
     // base cases
     if (this->type == TableScan)
-        return EvalPipeline(&this->table, this->table.select());
+        return EvalPipeline(&this->table, this->table.select_cursor(nullptr));
     if (this->type == Select && this->relation->type == TableScan)
-        return EvalPipeline(&this->relation->table, this->relation->table.select(this->select_conjunction));
+        return EvalPipeline(&this->relation->table, this->relation->table.select_cursor(this->select_conjunction));
 
     // recursive case
     if (this->type == Select) {
         EvalPipeline pipeline = this->relation->pipeline();
         DbRelation *temp_table = pipeline.first;
-        Handles *handles = pipeline.second;
-        EvalPipeline ret(temp_table, temp_table->select(handles, this->select_conjunction));
-        delete handles;
-        return ret;
+        return EvalPipeline(temp_table, temp_table->select_cursor(pipeline.second, this->select_conjunction));
     }
 
     throw DbRelationError("Not implemented: pipeline other than Select or TableScan");
 }
 
+// Look up the projection's columns in the table (all of them if projection is nullptr); takes the cursor
+EvalRows::EvalRows(DbRelation &table, SelectCursor *cursor, const ColumnNames *projection)
+        : table(table), cursor(cursor), column_names(), columns() {
+    this->column_names = projection != nullptr ? *projection : table.get_column_names();
+    try {
+        ColumnOrdinals *ordinals = table.get_column_ordinals(this->column_names);
+        this->columns = *ordinals;
+        delete ordinals;
+    } catch (...) {
+        delete cursor;
+        throw;
+    }
+}
+
+EvalRows::~EvalRows() {
+    delete cursor;
+}
+
+// Project the next row (freed by caller), or nullptr once there are no more
+Row *EvalRows::next() {
+    Handle handle;
+    if (!cursor->next(handle))
+        return nullptr;
+    Row *row = cursor->project_row(columns);  // from the block the cursor is on, if it can
+    if (row != nullptr)
+        return row;
+    return table.project_row(handle, columns);
+}
+
+// Key a row from next() by column name (freed by caller)
+ValueDict *EvalRows::to_value_dict(const Row &row) const {
+    return table.to_value_dict(row, columns);
+}
@@ -9,7 +9,40 @@
 #include "storage_engine.h"
 
 
-typedef std::pair<DbRelation *, Handles *> EvalPipeline;
+typedef std::pair<DbRelation *, SelectCursor *> EvalPipeline;
+
+/**
+ * @class EvalRows - the rows an evaluation plan comes to, projected one at a time as they are asked for
+ *
+ * The projection's column names are looked up once, up front, and each row comes back as a Row of values in
+ * the order of get_column_names().
+ */
+class EvalRows {
+public:
+    EvalRows(DbRelation &table, SelectCursor *cursor, const ColumnNames *projection);
+
+    virtual ~EvalRows();
+
+    EvalRows(const EvalRows &other) = delete;
+
+    EvalRows &operator=(const EvalRows &other) = delete;
+
+    virtual Row *next();
+
+    /**
+     * The columns of the rows, in order.
+     * @return the projection's column names (all of the table's for a ProjectAll)
+     */
+    virtual const ColumnNames &get_column_names() const { return column_names; }
+
+    virtual ValueDict *to_value_dict(const Row &row) const;
+
+protected:
+    DbRelation &table;
+    SelectCursor *cursor;      // freed with this
+    ColumnNames column_names;  // of the projection
+    ColumnOrdinals columns;    // where they are in the table
+};
 
 class EvalPlan {
 public:
@@ -27,9 +60,11 @@ public:
     // Attempt to get the best equivalent evaluation plan
     EvalPlan *optimize();
 
-    // Evaluate the plan: evaluate gets values, pipeline gets handles
+    // Evaluate the plan: evaluate gets values, stream gets them as they are asked for, pipeline gets handles
     ValueDicts *evaluate();
 
+    EvalRows *stream();
+
     EvalPipeline pipeline();
 
 protected:
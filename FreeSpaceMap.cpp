@@ -0,0 +1,175 @@
+/**
+ * @file FreeSpaceMap.cpp
+ * @see Seattle University, CPSC5300
+ */
+#include <algorithm>
+#include <cstring>
+#include "FreeSpaceMap.h"
+
+using namespace std;
+typedef uint32_t u32;
+
+/**
+ * Constructor
+ * @param name  name of the DbFile the map is for
+ */
+FreeSpaceMap::FreeSpaceMap(string name) : dbfilename(name + ".fsm.db"), step(1), categories(), chunk_max(),
+                                          dirty(), next_search(1), closed(true), db(nullptr) {
+}
+
+/**
+ * Read the map in, creating its file if there isn't one yet.
+ * @param block_size  size of the DbFile's blocks
+ */
+void FreeSpaceMap::open(u32 block_size) {
+    if (!this->closed)
+        return;
+    this->step = block_size / 256;
+    this->db = new Db(_DB_ENV, 0);
+    try {
+        this->db->set_re_len(CHUNK_SZ);
+        this->db->open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, DB_CREATE, 0644);
+        DB_BTREE_STAT *stat;
+        this->db->stat(nullptr, &stat, DB_FAST_STAT);
+        u32 chunks = stat->bt_ndata;
+        free(stat);
+
+        this->categories.assign(chunks * CHUNK_SZ, 0);
+        this->chunk_max.assign(chunks, 0);
+        this->dirty.assign(chunks, false);
+        for (u32 chunk = 0; chunk < chunks; chunk++) {
+            u32 recno = chunk + 1;
+            Dbt key(&recno, sizeof(recno));
+            Dbt data(this->categories.data() + chunk * CHUNK_SZ, CHUNK_SZ);
+            data.set_ulen(CHUNK_SZ);
+            data.set_flags(DB_DBT_USERMEM);
+            this->db->get(nullptr, &key, &data, 0);
+            auto start = this->categories.begin() + chunk * CHUNK_SZ;
+            this->chunk_max[chunk] = *max_element(start, start + CHUNK_SZ);
+        }
+    } catch (...) {
+        this->db->close(0);
+        delete this->db;
+        this->db = nullptr;
+        throw;
+    }
+    this->next_search = 1;
+    this->closed = false;
+}
+
+/**
+ * Write back the parts of the map that changed and close its file.
+ */
+void FreeSpaceMap::close(void) {
+    if (this->closed)
+        return;
+    flush();
+    this->db->close(0);
+    delete this->db;
+    this->db = nullptr;
+    this->closed = true;
+}
+
+/**
+ * Write back the parts of the map that changed and sync its file to disk.
+ */
+void FreeSpaceMap::flush(void) {
+    if (this->closed)
+        return;
+    for (u32 chunk = 0; chunk < this->dirty.size(); chunk++) {
+        if (!this->dirty[chunk])
+            continue;
+        u32 recno = chunk + 1;
+        Dbt key(&recno, sizeof(recno));
+        Dbt data(this->categories.data() + chunk * CHUNK_SZ, CHUNK_SZ);
+        this->db->put(nullptr, &key, &data, 0);
+        this->dirty[chunk] = false;
+    }
+    this->db->sync(0);
+}
+
+/**
+ * Delete the map's file.
+ */
+void FreeSpaceMap::drop(void) {
+    close();
+    try {
+        Db db(_DB_ENV, 0);
+        db.remove(this->dbfilename.c_str(), nullptr, 0);
+    } catch (DbException &e) {
+        // never had one
+    }
+}
+
+/**
+ * Record how much room a block has.
+ * @param block_id
+ * @param unused_bytes  the block's unused_bytes()
+ */
+void FreeSpaceMap::set(BlockID block_id, u32 unused_bytes) {
+    u32 i = block_id - 1;
+    u32 chunk = i / CHUNK_SZ;
+    if (chunk >= this->chunk_max.size()) {
+        this->categories.resize((chunk + 1) * CHUNK_SZ, 0);
+        this->chunk_max.resize(chunk + 1, 0);
+        this->dirty.resize(chunk + 1, false);
+    }
+    u_int8_t c = category(unused_bytes);
+    if (this->categories[i] == c)
+        return;
+    this->categories[i] = c;
+    this->chunk_max[chunk] = max(this->chunk_max[chunk], c);
+    this->dirty[chunk] = true;
+}
+
+/**
+ * How much room the map says a block has.
+ * @param block_id
+ * @return          at least this many bytes are free (0 if the block isn't in the map)
+ */
+u32 FreeSpaceMap::get(BlockID block_id) const {
+    if (block_id == 0 || block_id > this->categories.size())
+        return 0;
+    return this->categories[block_id - 1] * this->step;
+}
+
+/**
+ * Find a block with room. The search picks up where the last one left off, so consecutive inserts keep
+ * going to the same block until it is full.
+ * @param needed  number of bytes needed
+ * @return        a block that has at least that much room, or 0 if there aren't any
+ */
+BlockID FreeSpaceMap::find(u32 needed) {
+    u32 wanted = (needed + this->step - 1) / this->step;
+    if (wanted > 255 || this->chunk_max.empty())
+        return 0;
+    u32 chunks = (u32) this->chunk_max.size();
+    u32 first_chunk = (this->next_search - 1) / CHUNK_SZ;
+    for (u32 n = 0; n <= chunks; n++) {
+        u32 chunk = (first_chunk + n) % chunks;
+        if (this->chunk_max[chunk] < wanted)
+            continue;
+        u32 start = chunk * CHUNK_SZ;
+        if (n == 0)
+            start = this->next_search - 1;  // first time around, start from where we left off
+        for (u32 i = start; i < (chunk + 1) * CHUNK_SZ; i++) {
+            if (this->categories[i] >= wanted) {
+                this->next_search = i + 1;
+                return i + 1;
+            }
+        }
+        if (start == chunk * CHUNK_SZ) {
+            // looked at the whole chunk, so now we know its real maximum
+            auto begin = this->categories.begin() + chunk * CHUNK_SZ;
+            this->chunk_max[chunk] = *max_element(begin, begin + CHUNK_SZ);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Which category a number of free bytes falls in.
+ */
+u_int8_t FreeSpaceMap::category(u32 unused_bytes) const {
+    return (u_int8_t) min(unused_bytes / this->step, 255U);
+}
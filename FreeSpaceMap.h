@@ -0,0 +1,69 @@
+/**
+ * @file FreeSpaceMap.h - Free space map for a HeapFile.
+ * FreeSpaceMap
+ *
+ * @see "Seattle University, CPSC5300, Spring 2022"
+ */
+#pragma once
+
+#include "db_cxx.h"
+#include "storage_engine.h"
+
+/**
+ * @class FreeSpaceMap - how much room each block of a DbFile has left, so an insert can go straight to a
+ * block with room for it instead of only ever trying the last block.
+ *
+ * One byte per block: the number of free bytes in units of a 256th of the block size, rounded down (like
+ * PostgreSQL's FSM). The map is all in memory while the file is open. It is kept in its own Berkeley DB
+ * RecNo file, <name>.fsm.db, CHUNK_SZ blocks' worth per record, and only the chunks that changed are
+ * written back when it is flushed or closed.
+ *
+ * The map is only a hint: a block can have less room than it says if the map was not closed properly,
+ * so the caller must still check, and should set() the block's real free space if it was wrong. Blocks
+ * missing from the map are taken to have no room.
+ *
+ * Each chunk also keeps the most room any of its blocks has (never less than the truth), so a search for
+ * room can skip over chunks of full blocks without looking at them.
+ */
+class FreeSpaceMap {
+public:
+    FreeSpaceMap(std::string name);
+
+    virtual ~FreeSpaceMap() {}
+
+    FreeSpaceMap(const FreeSpaceMap &other) = delete;
+
+    FreeSpaceMap(FreeSpaceMap &&temp) = delete;
+
+    FreeSpaceMap &operator=(const FreeSpaceMap &other) = delete;
+
+    FreeSpaceMap &operator=(FreeSpaceMap &&temp) = delete;
+
+    virtual void open(u_int32_t block_size);
+
+    virtual void close(void);
+
+    virtual void flush(void);
+
+    virtual void drop(void);
+
+    virtual void set(BlockID block_id, u_int32_t unused_bytes);
+
+    virtual u_int32_t get(BlockID block_id) const;
+
+    virtual BlockID find(u_int32_t needed);
+
+protected:
+    static const u_int32_t CHUNK_SZ = 4096;  // blocks per map record
+
+    std::string dbfilename;
+    u_int32_t step;
+    std::vector<u_int8_t> categories;  // categories[block_id - 1]
+    std::vector<u_int8_t> chunk_max;
+    std::vector<bool> dirty;
+    BlockID next_search;
+    bool closed;
+    Db *db;  // the map's file while it is open (a Db can't be opened again once it is closed)
+
+    u_int8_t category(u_int32_t unused_bytes) const;
+};
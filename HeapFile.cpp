@@ -13,17 +13,47 @@ typedef uint16_t u16;
 /**
  * Constructor
  * @param name
+ * @param block_size         size of the blocks if the file gets created (power of two,
+ *                           DbBlock::MIN_BLOCK_SZ to DbBlock::MAX_BLOCK_SZ)
+ * @param column_attributes  layout of the records, needed to read PaxPage blocks (kept by the caller;
+ *                           nullptr if the file only ever holds SlottedPage blocks)
+ * @param pax                true to use PaxPage blocks if the file gets created
+ * @param free_space_map     true to keep a FreeSpaceMap for append() to use
+ * @param pool               buffer pool to keep the blocks in
  */
-HeapFile::HeapFile(string name) : DbFile(name), dbfilename(""), last(0), closed(true), db(_DB_ENV, 0) {
+HeapFile::HeapFile(string name, u_int32_t block_size, const ColumnAttributes *column_attributes, bool pax,
+                   bool free_space_map, BufferPool &pool)
+        : DbFile(name), dbfilename(""), block_size(block_size), last(0), allocated(0), empty_block(), closed(true),
+          column_attributes(column_attributes), pax(pax), row_format(0), pax_layout(nullptr), free_space(nullptr),
+          pool(pool), read_ahead(DEFAULT_READ_AHEAD), tail(nullptr), db(nullptr) {
+    if (block_size < DbBlock::MIN_BLOCK_SZ || block_size > DbBlock::MAX_BLOCK_SZ
+        || (block_size & (block_size - 1)) != 0)
+        throw DbRelationError("block size must be a power of two from " + to_string(DbBlock::MIN_BLOCK_SZ)
+                              + " to " + to_string(DbBlock::MAX_BLOCK_SZ));
+    if (pax && column_attributes == nullptr)
+        throw DbRelationError("PaxPage blocks need the column attributes");
     this->dbfilename = this->name + ".db";
+    if (free_space_map)
+        this->free_space = new FreeSpaceMap(this->name);
+}
+
+HeapFile::~HeapFile() {
+    HeapFile::close();  // its blocks can't be left in the pool under a Db that is going away
+    delete this->pax_layout;
+    delete this->free_space;
 }
 
 /**
- * Create physical file.
+ * Create physical file. Its block 1 is stamped with the row format from set_row_format().
  */
 void HeapFile::create(void) {
     db_open(DB_CREATE | DB_EXCL);
-    SlottedPage *page = get_new(); // force one page to exist
+    DbBlock *page = get_new(); // force one page to exist
+    SlottedPage *first = dynamic_cast<SlottedPage *>(page);
+    if (first != nullptr) {
+        first->set_row_format(this->row_format);
+        put(first);
+    }
     delete page;
 }
 
@@ -31,9 +61,13 @@ void HeapFile::create(void) {
  * Delete the physical file.
  */
 void HeapFile::drop(void) {
+    release_tail();
+    this->pool.discard(this);  // no point writing them back
     close();
     Db db(_DB_ENV, 0);
     db.remove(this->dbfilename.c_str(), nullptr, 0);
+    if (this->free_space != nullptr)
+        this->free_space->drop();
 }
 
 /**
@@ -47,61 +81,229 @@ void HeapFile::open(void) {
  * Close the physical file.
  */
 void HeapFile::close(void) {
-    this->db.close(0);
+    if (this->closed)
+        return;
+    release_tail();
+    this->pool.flush(this);
+    this->pool.discard(this);
+    db_close();
+    if (this->free_space != nullptr)
+        this->free_space->close();
     this->closed = true;
 }
 
 /**
- * Allocate a new block for the database file.
+ * Allocate a new block for the database file. The file grows a whole extent of empty blocks at a time, so
+ * most calls just hand out the next of those, initialized from a copy of an empty block, without going to
+ * Berkeley DB at all.
  * @return the new empty DbBlock that is managing the records in this block and its block id.
  */
-SlottedPage *HeapFile::get_new(void) {
-    char block[DbBlock::BLOCK_SZ];
-    memset(block, 0, sizeof(block));
-    Dbt data(block, sizeof(block));
-
-    int block_id = ++this->last;
-    Dbt key(&block_id, sizeof(block_id));
-
-    // write out an empty block and read it back in so Berkeley DB is managing the memory
-    SlottedPage *page = new SlottedPage(data, this->last, true);
-    this->db.put(nullptr, &key, &data, 0); // write it out with initialization done to it
-    delete page;
-    this->db.get(nullptr, &key, &data, 0);
-    return new SlottedPage(data, this->last);
+DbBlock *HeapFile::get_new(void) {
+    if (this->last == this->allocated)
+        preallocate();
+    BlockID block_id = ++this->last;
+    BufferFrame *frame = this->pool.pin(this, block_id, this->block_size, true);
+    memcpy(frame->get_data(), this->empty_block.data(), this->block_size);
+    frame->mark_dirty();  // what is in the file may be an emptied block rather than a fresh one
+    Dbt data(frame->get_data(), this->block_size);
+    DbBlock *page;
+    try {
+        page = make_block(data, block_id, false);
+    } catch (...) {
+        frame->unpin();
+        throw;
+    }
+    page->set_pin(frame);
+    if (this->free_space != nullptr)
+        this->free_space->set(block_id, page->unused_bytes());
+    return page;
 }
 
 /**
- * Get a block from the database file.
+ * Get a block from the database file (by way of the buffer pool).
  * @param block_id
- * @return          the given slotted page (freed by caller)
+ * @return          the given block (freed by caller), pinned in the buffer pool until it is freed
  */
-SlottedPage *HeapFile::get(BlockID block_id) {
-    Dbt key(&block_id, sizeof(block_id));
-    Dbt data;
-    this->db.get(nullptr, &key, &data, 0);
-    return new SlottedPage(data, block_id, false);
+DbBlock *HeapFile::get(BlockID block_id) {
+    forget_tail(block_id);
+    BufferFrame *frame = this->pool.pin(this, block_id, this->block_size);
+    Dbt data(frame->get_data(), this->block_size);
+    DbBlock *page;
+    try {
+        page = make_block(data, block_id, false);
+    } catch (...) {
+        frame->unpin();
+        throw;
+    }
+    page->set_pin(frame);
+    return page;
 }
 
 /**
- * Write a block back to the database file.
+ * Write a block back to the database file. A block from the buffer pool is just marked dirty there, and
+ * gets written out when it is evicted or the file is closed.
  * @param block
  */
 void HeapFile::put(DbBlock *block) {
-    int block_id = block->get_block_id();
-    Dbt key(&block_id, sizeof(block_id));
-    this->db.put(nullptr, &key, block->get_block(), 0);
+    BlockID block_id = block->get_block_id();
+    if (block->get_pin() != nullptr) {
+        block->get_pin()->mark_dirty();
+    } else {
+        write_page(block_id, (const char *) block->get_block()->get_data(), this->block_size);
+    }
+    if (this->free_space != nullptr)
+        this->free_space->set(block_id, block->unused_bytes());
+}
+
+/**
+ * Add records to the file. Blocks the free space map says have room are filled first (any the map turns
+ * out to be wrong about are corrected and the map is asked again), then the last block, then new blocks. The block the last record went into is kept pinned as the tail block, so the
+ * next append() can most likely go right into it without looking it up again.
+ * @param records  the data to store, one Dbt per record
+ * @param count    number of records
+ * @param handles  the handles of the new records get appended to this
+ * @throws DbBlockNoRoomError if a record won't fit even in an empty block (the ones before it are kept)
+ */
+void HeapFile::append(const Dbt *records, u_int32_t count, Handles &handles) {
+    RecordIDs record_ids;
+    u_int32_t done = 0;
+    while (done < count && this->free_space != nullptr) {
+        u_int32_t needed = records[done].get_size() + 4;  // 4 for a record header
+        BlockID block_id = this->free_space->find(needed);
+        if (block_id == 0)
+            break;
+        DbBlock *block = take(block_id);
+        record_ids.clear();
+        u_int32_t added = block->add_batch(records + done, count - done, record_ids);
+        if (added == 0) {
+            // map was out of date: put it right, never leaving the block where find() would give it back
+            u_int32_t unused = block->unused_bytes();
+            this->free_space->set(block_id, unused < needed ? unused : needed - 1);
+            delete block;
+            continue;
+        }
+        put(block);
+        keep(block, done + added == count);
+        for (RecordID record_id : record_ids)
+            handles.push_back(Handle(block_id, record_id));
+        done += added;
+    }
+
+    if (done < count) {
+        BlockID block_id = this->last;
+        DbBlock *block = take(block_id);
+        record_ids.clear();
+        u_int32_t added = block->add_batch(records + done, count - done, record_ids);
+        if (added > 0)
+            put(block);
+        keep(block, done + added == count);
+        for (RecordID record_id : record_ids)
+            handles.push_back(Handle(block_id, record_id));
+        done += added;
+    }
+
+    while (done < count) {
+        DbBlock *block = get_new();
+        record_ids.clear();
+        u_int32_t added = block->add_batch(records + done, count - done, record_ids);
+        if (added == 0) {
+            delete block;  // stays as the empty last block
+            throw DbBlockNoRoomError("record too big for an empty block");
+        }
+        put(block);
+        for (RecordID record_id : record_ids)
+            handles.push_back(Handle(block->get_block_id(), record_id));
+        done += added;
+        keep(block, done == count);
+    }
+}
+
+/**
+ * Write out any changed blocks of the file that are still in memory, along with its free space map, and
+ * sync it to disk.
+ */
+void HeapFile::flush(void) {
+    if (this->closed)
+        return;
+    release_tail();
+    this->pool.flush(this);
+    if (this->free_space != nullptr)
+        this->free_space->flush();
+    sync();
+}
+
+/**
+ * Get a block for append() to add to: the tail block if that's the one, otherwise get() it.
+ * @param block_id
+ * @return          the block (freed by caller, or handed back with keep())
+ */
+DbBlock *HeapFile::take(BlockID block_id) {
+    if (this->tail != nullptr && this->tail->get_block_id() == block_id) {
+        DbBlock *block = this->tail;
+        this->tail = nullptr;
+        return block;
+    }
+    return get(block_id);
+}
+
+/**
+ * Done adding to a block in append(). It becomes the tail block unless it is full.
+ * @param block    the block (already put())
+ * @param has_room true if it might take another record (the last one fit)
+ */
+void HeapFile::keep(DbBlock *block, bool has_room) {
+    if (!has_room) {
+        delete block;
+        return;
+    }
+    release_tail();
+    this->tail = block;
+}
+
+/**
+ * Sync the file to disk, once its blocks have been written to it.
+ */
+void HeapFile::sync(void) {
+    this->db->sync(0);
+}
+
+/**
+ * Let go of the tail block.
+ */
+void HeapFile::release_tail(void) {
+    delete this->tail;
+    this->tail = nullptr;
+}
+
+/**
+ * Let go of the tail block if it is the given block, since somebody else is about to work on it (the
+ * tail block's DbBlock would not know about their changes).
+ * @param block_id
+ */
+void HeapFile::forget_tail(BlockID block_id) {
+    if (this->tail != nullptr && this->tail->get_block_id() == block_id)
+        release_tail();
 }
 
 /**
  * Sequence of all block ids.
  * @return block ids
  */
-BlockIDs *HeapFile::block_ids() const {
-    BlockIDs *vec = new BlockIDs();
-    for (BlockID block_id = 1; block_id <= this->last; block_id++)
-        vec->push_back(block_id);
-    return vec;
+BlockIDRange HeapFile::block_ids() const {
+    return BlockIDRange(1, this->last);
+}
+
+/**
+ * Read a run of blocks in order. Much quicker than get()ting them one by one, since they come out of
+ * Berkeley DB get_read_ahead() at a time.
+ * @param range  blocks to read (any past the last block are skipped)
+ * @return       the scan (freed by caller, before the file is closed)
+ */
+BlockScan *HeapFile::scan(BlockIDRange range) {
+    range = range.subrange(1, this->last);
+    if (this->read_ahead > 1 && !range.empty())
+        return new BulkBlockScan(*this, range, this->read_ahead);
+    return new BlockScan(*this, range);
 }
 
 /**
@@ -110,7 +312,7 @@ BlockIDs *HeapFile::block_ids() const {
  */
 uint32_t HeapFile::get_block_count() {
     DB_BTREE_STAT *stat;
-    this->db.stat(nullptr, &stat, DB_FAST_STAT);
+    this->db->stat(nullptr, &stat, DB_FAST_STAT);
     uint32_t bt_ndata = stat->bt_ndata;
     free(stat);
     return bt_ndata;
@@ -123,9 +325,276 @@ uint32_t HeapFile::get_block_count() {
 void HeapFile::db_open(uint flags) {
     if (!this->closed)
         return;
-    this->db.set_re_len(DbBlock::BLOCK_SZ); // record length - will be ignored if file already exists
-    this->db.open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags, 0644);
+    this->db = new Db(_DB_ENV, 0);
+    try {
+        this->db->set_re_len(this->block_size); // record length - will be ignored if file already exists
+        this->db->open(nullptr, this->dbfilename.c_str(), nullptr, DB_RECNO, flags, 0644);
+        this->db->get_re_len(&this->block_size); // so pick up whatever the file was created with
+
+        this->last = this->allocated = flags ? 0 : get_block_count();
+        Dbt data;
+        if (this->last > 0) {
+            BlockID block_id = 1;
+            Dbt key(&block_id, sizeof(block_id));
+            this->db->get(nullptr, &key, &data, 0);
+        }
+        opened(this->last > 0 ? &data : nullptr);
+    } catch (...) {
+        db_close();
+        throw;
+    }
+    reclaim_tail();
+}
+
+/**
+ * Close the Berkeley DB file, if it is open, and let go of its Db.
+ */
+void HeapFile::db_close(void) {
+    if (this->db == nullptr)
+        return;
+    this->db->close(0);
+    delete this->db;
+    this->db = nullptr;
+}
+
+/**
+ * Take back the empty blocks at the end of a file that has just been opened. They were never handed out
+ * (or have nothing in them now), so get_new() can have them.
+ */
+void HeapFile::reclaim_tail() {
+    while (this->last > 1 && this->allocated - this->last < EXTENT_BLOCKS && is_empty(this->last)) {
+        if (this->free_space != nullptr)
+            this->free_space->set(this->last, 0);  // so append() doesn't put anything past the last block
+        this->last--;
+    }
+}
+
+/**
+ * Set up the copy of an empty block that new blocks start out as.
+ */
+void HeapFile::init_empty_block() {
+    if (!this->empty_block.empty())
+        return;
+    this->empty_block.assign(this->block_size, 0);
+    Dbt data(this->empty_block.data(), this->block_size);
+    delete make_block(data, 0, true);
+}
+
+/**
+ * Add an extent of empty blocks to the end of the file.
+ */
+void HeapFile::preallocate() {
+    init_empty_block();
+    Dbt data(this->empty_block.data(), this->block_size);
+    for (u_int32_t i = 0; i < EXTENT_BLOCKS; i++) {
+        BlockID block_id = ++this->allocated;
+        Dbt key(&block_id, sizeof(block_id));
+        this->db->put(nullptr, &key, &data, 0);
+    }
+}
+
+/**
+ * Check if a block has no records in it.
+ * @param block_id
+ * @return          true if it is empty
+ */
+bool HeapFile::is_empty(BlockID block_id) {
+    DbBlock *block = get(block_id);
+    RecordIDs *record_ids = block->ids();
+    bool empty = record_ids->empty();
+    delete record_ids;
+    delete block;
+    return empty;
+}
 
-    this->last = flags ? 0 : get_block_count();
+/**
+ * Finish opening the file once its blocks can be read: pick the kind of block and read the row format off
+ * block 1, open the free space map and set up the empty block that new blocks start out as.
+ * @param first_block  block 1, or nullptr if the file has no blocks yet
+ * @throws DbRelationError if the blocks are PaxPages and there are no column attributes to read them
+ */
+void HeapFile::opened(const Dbt *first_block) {
+    if (first_block != nullptr) {
+        this->pax = PaxPage::is_pax(*first_block);  // an existing file keeps whichever kind it was created with
+        this->row_format = this->pax ? 0 : SlottedPage::row_format_of(*first_block);
+    }
+    if (this->pax && this->pax_layout == nullptr) {
+        if (this->column_attributes == nullptr)
+            throw DbRelationError(this->name + " has PaxPage blocks but no column attributes to read them");
+        this->pax_layout = new PaxLayout(*this->column_attributes, this->block_size);
+    }
+    if (this->free_space != nullptr)
+        this->free_space->open(this->block_size);
+    this->empty_block.clear();  // a reopened file can still have blocks left in its last extent
+    init_empty_block();
     this->closed = false;
 }
+
+/**
+ * Read a block from the Berkeley DB file (for the buffer pool).
+ * @param block_id  which block
+ * @param data      where to put it
+ * @param size      the block size
+ */
+void HeapFile::read_page(BlockID block_id, char *data, u_int32_t size) {
+    Dbt key(&block_id, sizeof(block_id));
+    Dbt dbt(data, size);
+    dbt.set_ulen(size);
+    dbt.set_flags(DB_DBT_USERMEM);
+    this->db->get(nullptr, &key, &dbt, 0);
+}
+
+/**
+ * Write a block to the Berkeley DB file.
+ * @param block_id  which block
+ * @param data      the block's memory
+ * @param size      the block size
+ */
+void HeapFile::write_page(BlockID block_id, const char *data, u_int32_t size) {
+    Dbt key(&block_id, sizeof(block_id));
+    Dbt dbt((void *) data, size);
+    this->db->put(nullptr, &key, &dbt, 0);
+}
+
+/**
+ * Put the right kind of DbBlock around a block's memory.
+ * @param data      the block's memory
+ * @param block_id
+ * @param is_new    true to initialize the block
+ * @return          SlottedPage or PaxPage (freed by caller)
+ */
+DbBlock *HeapFile::make_block(Dbt &data, BlockID block_id, bool is_new) {
+    if (this->pax)
+        return new PaxPage(data, block_id, *this->pax_layout, is_new);
+    return new SlottedPage(data, block_id, is_new);
+}
+
+
+/**
+ * Constructor
+ * @param file        the file to read
+ * @param range       which of its blocks
+ * @param read_ahead  how many blocks ahead to have the file prefetch (0 for none)
+ */
+BlockScan::BlockScan(HeapFile &file, BlockIDRange range, u_int32_t read_ahead)
+        : file(file), next_id(range.get_first()), last_id(range.get_last()), read_ahead(read_ahead),
+          prefetched(range.get_first() - 1) {
+}
+
+/**
+ * Get the next block.
+ * @return  the block (freed by caller, before calling next() again), or nullptr once there are no more
+ */
+DbBlock *BlockScan::next() {
+    if (this->next_id > this->last_id || this->next_id == 0)
+        return nullptr;
+    if (this->read_ahead > 0 && this->prefetched < this->last_id
+        && this->next_id + this->read_ahead / 2 > this->prefetched) {
+        // window is half used up, so ask for the next stretch while we work through the rest
+        BlockIDRange window(max(this->prefetched + 1, this->next_id), this->next_id + this->read_ahead - 1);
+        window = window.subrange(1, this->last_id);
+        this->file.prefetch(window);
+        this->prefetched = window.get_last();
+    }
+    return this->file.get(this->next_id++);
+}
+
+/**
+ * Get a block from the buffer pool, but only if it is there already.
+ * @param block_id
+ * @return          the block (freed by caller), or nullptr if it isn't in the pool
+ */
+DbBlock *BlockScan::pooled(BlockID block_id) {
+    BufferFrame *frame = this->file.pool.find(&this->file, block_id);
+    if (frame == nullptr)
+        return nullptr;
+    Dbt data(frame->get_data(), this->file.block_size);
+    DbBlock *block;
+    try {
+        block = this->file.make_block(data, block_id);
+    } catch (...) {
+        frame->unpin();
+        throw;
+    }
+    block->set_pin(frame);
+    return block;
+}
+
+/**
+ * Constructor
+ * @param file        the file to read
+ * @param range       which of its blocks (not empty)
+ * @param read_ahead  how many blocks to get from Berkeley DB at a time
+ */
+BulkBlockScan::BulkBlockScan(HeapFile &file, BlockIDRange range, u_int32_t read_ahead)
+        : BlockScan(file, range), cursor(nullptr), buffer(), bulk(), batch(nullptr), started(false) {
+    // room for the blocks plus Berkeley DB's bookkeeping, in a multiple of 1KB as it insists
+    size_t size = (size_t) read_ahead * (file.block_size + 64);
+    this->buffer.resize((size + 1023) / 1024 * 1024);
+    file.db->cursor(nullptr, &this->cursor, 0);
+}
+
+BulkBlockScan::~BulkBlockScan() {
+    delete this->batch;
+    this->cursor->close();
+}
+
+/**
+ * Get the next block.
+ * @return  the block (freed by caller, before calling next() again), or nullptr once there are no more
+ */
+DbBlock *BulkBlockScan::next() {
+    while (this->next_id <= this->last_id) {
+        if (this->batch == nullptr && !fill())
+            return nullptr;
+        db_recno_t recno;
+        Dbt data;
+        if (!this->batch->next(recno, data)) {
+            delete this->batch;
+            this->batch = nullptr;
+            continue;
+        }
+        if (recno < this->next_id)
+            continue;
+        BlockID block_id = recno;
+        this->next_id = block_id + 1;
+        if (block_id > this->last_id)
+            return nullptr;
+
+        DbBlock *block = pooled(block_id);
+        if (block == nullptr)
+            block = unpack(data, block_id);
+        return block;
+    }
+    return nullptr;
+}
+
+/**
+ * Make a block out of one of the records in the bulk buffer.
+ * @param data      the record
+ * @param block_id  its block id
+ * @return          the block (freed by caller), right on the record
+ */
+DbBlock *BulkBlockScan::unpack(Dbt &data, BlockID block_id) {
+    return this->file.make_block(data, block_id);
+}
+
+/**
+ * Get the next bunch of blocks from Berkeley DB into the buffer.
+ * @return  false if there aren't any more
+ */
+bool BulkBlockScan::fill() {
+    db_recno_t recno = this->next_id;
+    Dbt key(&recno, sizeof(recno));
+    this->bulk.set_data(this->buffer.data());
+    this->bulk.set_ulen((u_int32_t) this->buffer.size());
+    this->bulk.set_flags(DB_DBT_USERMEM);
+    int ret = this->cursor->get(&key, &this->bulk, (this->started ? DB_NEXT : DB_SET) | DB_MULTIPLE_KEY);
+    this->started = true;
+    if (ret == DB_NOTFOUND) {
+        this->next_id = this->last_id + 1;
+        return false;
+    }
+    this->batch = new DbMultipleRecnoDataIterator(this->bulk);
+    return true;
+}
@@ -9,7 +9,11 @@
 
 #include "db_cxx.h"
 #include "SlottedPage.h"
+#include "PaxPage.h"
+#include "FreeSpaceMap.h"
+#include "BufferPool.h"
 
+class BlockScan;
 
 /**
  * @class HeapFile - heap file implementation of DbFile
@@ -17,13 +21,25 @@
  * Heap file organization. Built on top of Berkeley DB RecNo file. There is one of our
         database blocks for each Berkeley DB record in the RecNo file. In this way we are using Berkeley DB
         for buffer management and file management.
-        Uses SlottedPage for storing records within blocks.
+        Uses SlottedPage for storing records within blocks, or PaxPage if the file is created for a table
+        that wants its columns grouped. The blocks say which they are, so an existing file is always read
+        with the layout it was created with (PaxPage needs the column attributes to do that).
+        A SlottedPage file also keeps the row format its user says its records are in (see set_row_format())
+        in the header of block 1, so the format goes wherever the file goes.
+
+        The file grows EXTENT_BLOCKS empty blocks at a time. Blocks past the last one handed out by get_new()
+        are not part of the file as far as block_ids() goes, and are found again when it is reopened.
+
+        The block size is picked when the file is created and is kept by Berkeley DB as the RecNo record
+        length, so an existing file is always opened with the block size it was created with.
  */
-class HeapFile : public DbFile {
+class HeapFile : public DbFile, public PageIO {
 public:
-    HeapFile(std::string name);
+    HeapFile(std::string name, u_int32_t block_size = DbBlock::BLOCK_SZ,
+             const ColumnAttributes *column_attributes = nullptr, bool pax = false, bool free_space_map = false,
+             BufferPool &pool = BufferPool::shared());
 
-    virtual ~HeapFile() {}
+    virtual ~HeapFile();
 
     HeapFile(const HeapFile &other) = delete;
 
@@ -41,13 +57,23 @@ public:
 
     virtual void close(void);
 
-    virtual SlottedPage *get_new(void);
+    virtual DbBlock *get_new(void);
 
-    virtual SlottedPage *get(BlockID block_id);
+    virtual DbBlock *get(BlockID block_id);
 
     virtual void put(DbBlock *block);
 
-    virtual BlockIDs *block_ids() const;
+    virtual void append(const Dbt *records, u_int32_t count, Handles &handles);
+
+    virtual void flush(void);
+
+    virtual void read_page(BlockID block_id, char *data, u_int32_t size);
+
+    virtual void write_page(BlockID block_id, const char *data, u_int32_t size);
+
+    virtual BlockIDRange block_ids() const;
+
+    using DbFile::block_ids;
 
     /**
      * Get the id of the current final block in the heap file.
@@ -55,14 +81,150 @@ public:
      */
     virtual uint32_t get_last_block_id() { return last; }
 
+    /**
+     * Get the size of the blocks in this file.
+     * @return number of bytes per block
+     */
+    virtual u_int32_t get_block_size() const { return block_size; }
+
+    /**
+     * Check if the blocks in this file are PaxPages.
+     * @return true for PaxPage, false for SlottedPage
+     */
+    virtual bool is_pax() const { return pax; }
+
+    /**
+     * Get the row format of the file's records, as read from block 1 when it was opened.
+     * @return the row format, or 0 if there is none (PaxPage blocks, or one never set)
+     */
+    virtual u_int16_t get_row_format() const { return row_format; }
+
+    /**
+     * Set the row format to stamp on block 1 if the file gets created (what it means is up to the caller).
+     * An existing file keeps its own.
+     * @param row_format  the row format
+     */
+    virtual void set_row_format(u_int16_t row_format) { this->row_format = row_format; }
+
+    virtual BlockScan *scan(BlockIDRange range);
+
+    /**
+     * Set how many blocks a scan() reads from the file at a time.
+     * @param blocks  number of blocks (1 reads them one at a time)
+     */
+    virtual void set_read_ahead(u_int32_t blocks) { read_ahead = blocks < 1 ? 1 : blocks; }
+
+    virtual u_int32_t get_read_ahead() const { return read_ahead; }
+
+    static const u_int32_t DEFAULT_READ_AHEAD = 32;
+
+    static const u_int32_t EXTENT_BLOCKS = 8;  // how many blocks the file grows by at a time
+
 protected:
     std::string dbfilename;
-    uint32_t last;
+    u_int32_t block_size;
+    uint32_t last;       // last block handed out by get_new()
+    uint32_t allocated;  // last block in the file (the ones after last are empty, waiting for get_new())
+    std::vector<char> empty_block;
     bool closed;
-    Db db;
+    const ColumnAttributes *column_attributes;
+    bool pax;
+    u_int16_t row_format;
+    PaxLayout *pax_layout;
+    FreeSpaceMap *free_space;
+    BufferPool &pool;
+    u_int32_t read_ahead;
+    DbBlock *tail;  // block append() last added to, kept pinned for the next append() (or nullptr)
+    Db *db;  // the Berkeley DB file while it is open (a Db can't be opened again once it is closed)
 
     virtual void db_open(uint flags = 0);
 
+    virtual void db_close(void);
+
+    virtual void opened(const Dbt *first_block);
+
+    virtual void reclaim_tail();
+
+    virtual void init_empty_block();
+
+    virtual void preallocate();
+
+    virtual bool is_empty(BlockID block_id);
+
+    virtual DbBlock *take(BlockID block_id);
+
+    virtual void keep(DbBlock *block, bool has_room);
+
+    virtual void release_tail(void);
+
+    virtual void sync(void);
+
+    virtual void forget_tail(BlockID block_id);
+
+    virtual DbBlock *make_block(Dbt &data, BlockID block_id, bool is_new = false);
+
     virtual uint32_t get_block_count();
+
+    friend class BlockScan;
+    friend class BulkBlockScan;
+    friend bool test_heap_storage();
+};
+
+/**
+ * @class BlockScan - reads a run of a HeapFile's blocks in order, e.g.:
+ *     BlockScan *scan = file.scan(file.block_ids());
+ *     for (DbBlock *block = scan->next(); block != nullptr; block = scan->next()) { ...; delete block; }
+ *     delete scan;
+ * This one just get()s each block in turn, optionally keeping the file prefetching a window of the blocks
+ * coming up next.
+ */
+class BlockScan {
+public:
+    BlockScan(HeapFile &file, BlockIDRange range, u_int32_t read_ahead = 0);
+
+    virtual ~BlockScan() {}
+
+    BlockScan(const BlockScan &other) = delete;
+
+    BlockScan &operator=(const BlockScan &other) = delete;
+
+    virtual DbBlock *next();
+
+protected:
+    HeapFile &file;
+    BlockID next_id;
+    BlockID last_id;
+    u_int32_t read_ahead;  // size of the prefetch window (0 for none)
+    BlockID prefetched;    // last block prefetched so far
+
+    virtual DbBlock *pooled(BlockID block_id);
+};
+
+/**
+ * @class BulkBlockScan - BlockScan that gets blocks out of Berkeley DB read_ahead at a time, with a cursor
+ * and bulk retrieval (DB_MULTIPLE_KEY), instead of with a db.get() apiece.
+ *
+ * A block that is in the buffer pool is used from there, since it may be newer than the one in the file.
+ * The rest are used right where they are in the bulk buffer and are not put in the pool, so a big scan
+ * doesn't push everything else out of it.
+ */
+class BulkBlockScan : public BlockScan {
+public:
+    BulkBlockScan(HeapFile &file, BlockIDRange range, u_int32_t read_ahead);
+
+    virtual ~BulkBlockScan();
+
+    virtual DbBlock *next();
+
+protected:
+    Dbc *cursor;
+    std::vector<char> buffer;
+    Dbt bulk;
+    DbMultipleRecnoDataIterator *batch;  // what is left of the last bulk get, or nullptr for none
+    bool started;
+
+    virtual bool fill();
+
+    virtual DbBlock *unpack(Dbt &data, BlockID block_id);
 };
 
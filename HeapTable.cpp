@@ -3,20 +3,58 @@
  * @author K Lundeen
  * @see Seattle University, CPSC5300
  */
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
+#include <unistd.h>
 #include "HeapTable.h"
 
 using namespace std;
 typedef uint16_t u16;
+typedef uint32_t u32;
 
 /**
  * Constructor
  * @param table_name
  * @param column_names
  * @param column_attributes
+ * @param block_size  block size to use if the table gets created (bigger for scan-heavy tables, smaller
+ *                    for ones that see lots of single-row access); an existing table keeps its own
+ * @param pax         true to store the rows column-grouped (PaxPage) if the table gets created; good for
+ *                    tables that are mostly scanned for a few columns. An existing table keeps its own.
+ * @param storage     kind of file the table is kept in: MAPPED is good for read-mostly tables, DIRECT for
+ *                    ones bigger than the memory they should get, COMPRESSED for cold ones full of
+ *                    repetitive text, STRIPED for big scanned ones (spread over the disks of
+ *                    Tablespace::shared()). It isn't looked up, so an existing table has to be given the
+ *                    kind it was created with.
  */
-HeapTable::HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes) : DbRelation(
-        table_name, column_names, column_attributes), file(table_name) {
+HeapTable::HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes,
+                     u_int32_t block_size, bool pax, Storage storage)
+        : DbRelation(table_name, column_names, column_attributes), file(nullptr),
+          overflow(table_name + ".overflow", block_size), row_format(ROW_FORMAT_1), locations() {
+    switch (storage) {
+        case MAPPED:
+            this->file = new MappedFile(table_name, block_size, &this->column_attributes, pax, true);
+            break;
+        case DIRECT:
+            this->file = new DirectFile(table_name, block_size, &this->column_attributes, pax, true);
+            break;
+        case COMPRESSED:
+            this->file = new CompressedFile(table_name, block_size, &this->column_attributes, pax, true);
+            break;
+        case STRIPED:
+            this->file = new StripedFile(table_name, Tablespace::shared(), block_size, &this->column_attributes, pax,
+                                         true);
+            break;
+        default:
+            this->file = new HeapFile(table_name, block_size, &this->column_attributes, pax, true);
+    }
+    set_row_format(ROW_FORMAT_1);  // until the file is open and says otherwise
+}
+
+HeapTable::~HeapTable() {
+    delete this->file;
 }
 
 /**
@@ -24,7 +62,9 @@ HeapTable::HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttr
  * Is not responsible for metadata storage or validation.
  */
 void HeapTable::create() {
-    file.create();
+    file->set_row_format(file->is_pax() ? ROW_FORMAT_1 : ROW_FORMAT_2);
+    file->create();
+    set_row_format(file->get_row_format());
 }
 
 /**
@@ -43,21 +83,42 @@ void HeapTable::create_if_not_exists() {
  * Execute: DROP TABLE <table_name>
  */
 void HeapTable::drop() {
-    file.drop();
+    file->drop();
+    try {
+        overflow.drop();
+    } catch (DbException &e) {
+        // never needed one
+    }
+    set_row_format(ROW_FORMAT_1);
 }
 
 /**
  * Open existing table. Enables: insert, update, delete, select, project
+ * @throws DbRelationError if the table's rows are in a row format this doesn't know
  */
 void HeapTable::open() {
-    file.open();
+    file->open();
+    u_int16_t format = file->is_pax() || file->get_row_format() == 0 ? ROW_FORMAT_1 : file->get_row_format();
+    if (format != ROW_FORMAT_1 && format != ROW_FORMAT_2)
+        throw DbRelationError(this->table_name + " is of an unknown row format");
+    if (format != this->row_format)
+        set_row_format(format);
 }
 
 /**
  * Closes the table. Disables: insert, update, delete, select, project
  */
 void HeapTable::close() {
-    file.close();
+    file->close();
+    overflow.close();
+}
+
+/**
+ * Write out all the table's changes that are still only in memory (the table stays open).
+ */
+void HeapTable::flush() {
+    file->flush();
+    overflow.flush();
 }
 
 /**
@@ -73,15 +134,134 @@ Handle HeapTable::insert(const ValueDict *row) {
     return handle;
 }
 
+/**
+ * Insert a lot of rows at once. Much cheaper than one insert() per row for loading a table, since the
+ * blocks are filled up in memory and each is written to the file just once. The rows go in all together
+ * or not at all.
+ * @param rows  dictionaries with column name keys
+ * @return      the handles of the inserted rows, in order (freed by caller)
+ * @throws DbBlockNoRoomError if a row is too big for even an empty block (none of the rows are kept)
+ */
+Handles *HeapTable::insert_batch(const ValueDicts *rows) {
+    open();
+    vector<Dbt> records;
+    records.reserve(rows->size());
+    Handles *handles = new Handles();
+    handles->reserve(rows->size());
+    try {
+        for (auto const &row: *rows) {
+            ValueDict *full_row = validate(row);
+            Dbt *data = marshal(full_row);
+            delete full_row;
+            records.push_back(*data);
+            delete data;
+        }
+        this->file->append(records.data(), (u32) records.size(), *handles);
+    } catch (...) {
+        // the rows that got in are taken back out (chunks and all), and the chunks of the rest are freed
+        for (Handle &handle: *handles)
+            del(handle);
+        for (size_t i = handles->size(); i < records.size(); i++)
+            del_overflow(RecordView(records[i].get_data(), records[i].get_size()));
+        for (Dbt &data: records)
+            delete[] (char *) data.get_data();
+        delete handles;
+        throw;
+    }
+    for (Dbt &data: records)
+        delete[] (char *) data.get_data();
+    return handles;
+}
+
 /**
  * Conceptually, execute: UPDATE INTO <table_name> SET <new_values> WHERE <handle>
  * where handle is sufficient to identify one specific record (e.g., returned from an insert
  * or select).
+ *
+ * The row is rewritten in its home block if it fits there (which also brings a row that had been moved
+ * back home). Otherwise it is rewritten where it was moved to, or moved to the side file with a
+ * forwarding stub left in its home block. Either way the handle stays the same.
+ *
  * @param handle the row to be updated
  * @param new_values a dictionary with column name keys
+ * @throws DbRelationError if the row has to move but its block has no room for the forwarding stub
  */
 void HeapTable::update(const Handle handle, const ValueDict *new_values) {
-    throw DbRelationError("Not implemented");
+    open();
+    ValueDict *row = project(handle);
+    for (auto const &new_value: *new_values) {
+        if (row->find(new_value.first) == row->end()) {
+            delete row;
+            throw DbRelationError("table does not have column named '" + new_value.first + "'");
+        }
+        (*row)[new_value.first] = new_value.second;
+    }
+    ValueDict *full_row = validate(row);
+    delete row;
+    Dbt *data = marshal(full_row);
+    delete full_row;
+
+    BlockID block_id = handle.first;
+    RecordID record_id = handle.second;
+    DbBlock *block = this->file->get(block_id);
+    BlockID moved_block_id;
+    RecordID moved_record_id;
+    DbBlock *moved = nullptr;
+    string old_data;
+    if (block->get_forward(record_id, moved_block_id, moved_record_id)) {
+        open_overflow();
+        moved = this->overflow.get(moved_block_id);
+        RecordView old_view = moved->view(moved_record_id);
+        old_data.assign(old_view.get_data(), old_view.get_size());
+    } else {
+        RecordView old_view = block->view(record_id);
+        old_data.assign(old_view.get_data(), old_view.get_size());
+    }
+
+    try {
+        block->put(record_id, *data);
+        this->file->put(block);
+        if (moved != nullptr) {
+            moved->del(moved_record_id);
+            this->overflow.put(moved);
+        }
+    } catch (DbBlockNoRoomError &e) {
+        bool rewritten = false;
+        if (moved != nullptr) {
+            try {
+                moved->put(moved_record_id, *data);
+                rewritten = true;
+            } catch (DbBlockNoRoomError &e) {
+                moved->del(moved_record_id);
+            }
+            this->overflow.put(moved);
+            delete moved;  // move_out() may put the row in this very block
+            moved = nullptr;
+        }
+        if (!rewritten) {
+            Handle moved_handle = move_out(*data);
+            try {
+                block->forward(record_id, moved_handle.first, moved_handle.second);
+            } catch (DbBlockNoRoomError &e) {
+                // the row is left as it was, so the moved copy and its new chunks go back out
+                DbBlock *moved_block = this->overflow.get(moved_handle.first);
+                moved_block->del(moved_handle.second);
+                this->overflow.put(moved_block);
+                delete moved_block;
+                delete block;
+                del_overflow(RecordView(data->get_data(), data->get_size()));
+                delete[] (char *) data->get_data();
+                delete data;
+                throw DbRelationError("no room in block " + to_string(block_id) + " to forward the row");
+            }
+            this->file->put(block);
+        }
+    }
+    delete moved;
+    delete block;
+    delete[] (char *) data->get_data();
+    delete data;
+    del_overflow(RecordView(old_data.data(), (u32) old_data.size()));
 }
 
 /**
@@ -94,9 +274,30 @@ void HeapTable::del(const Handle handle) {
     open();
     BlockID block_id = handle.first;
     RecordID record_id = handle.second;
-    SlottedPage *block = this->file.get(block_id);
+    DbBlock *block = this->file->get(block_id);
+    BlockID moved_block_id;
+    RecordID moved_record_id;
+    if (block->get_forward(record_id, moved_block_id, moved_record_id)) {
+        open_overflow();
+        DbBlock *moved = this->overflow.get(moved_block_id);
+        RecordView moved_view = moved->view(moved_record_id);
+        string moved_data(moved_view.get_data(), moved_view.get_size());
+        delete moved;  // del_overflow() may have to change this very block for the row's chunks
+        del_overflow(RecordView(moved_data.data(), (u32) moved_data.size()));
+        moved = this->overflow.get(moved_block_id);
+        moved->del(moved_record_id);
+        this->overflow.put(moved);
+        delete moved;
+    } else {
+        RecordView view = block->view(record_id);
+        if (view.get_data() == nullptr) {
+            delete block;
+            return;  // already deleted
+        }
+        del_overflow(view);
+    }
     block->del(record_id);
-    this->file.put(block);
+    this->file->put(block);
     delete block;
 }
 
@@ -114,24 +315,30 @@ Handles *HeapTable::select() {
  * @return list of handles of the selected rows
  */
 Handles *HeapTable::select(const ValueDict *where) {
-    open();
     Handles *handles = new Handles();
-    BlockIDs *block_ids = file.block_ids();
-    for (auto const &block_id: *block_ids) {
-        SlottedPage *block = file.get(block_id);
-        RecordIDs *record_ids = block->ids();
-        for (auto const &record_id: *record_ids) {
-            Handle handle(block_id, record_id);
-            if (selected(handle, where))
-                handles->push_back(handle);
-        }
-        delete record_ids;
-        delete block;
+    SelectCursor *cursor = select_cursor(where);
+    try {
+        for (Handle handle; cursor->next(handle);)
+            handles->push_back(handle);
+    } catch (...) {
+        delete cursor;
+        delete handles;
+        throw;
     }
-    delete block_ids;
+    delete cursor;
     return handles;
 }
 
+/**
+ * The select command, finding the rows a block at a time as they are asked for
+ * @param where predicates to match (copied), or nullptr for all the rows
+ * @return      the selected rows (freed by caller, before the table is closed)
+ */
+SelectCursor *HeapTable::select_cursor(const ValueDict *where) {
+    open();
+    return new HeapTableCursor(*this, where);
+}
+
 /**
  * Refine another selection
  *
@@ -140,10 +347,26 @@ Handles *HeapTable::select(const ValueDict *where) {
  * @return                  list of handles of the selected rows
  */
 Handles *HeapTable::select(Handles *current_selection, const ValueDict *where) {
+    open();
+    RowMatcher matcher(*this, where);
     Handles *handles = new Handles();
-    for (auto const &handle: *current_selection)
-        if (selected(handle, where))
-            handles->push_back(handle);
+    DbBlock *block = nullptr;
+    try {
+        for (auto const &handle: *current_selection) {
+            if (block == nullptr || block->get_block_id() != handle.first) {
+                delete block;
+                block = nullptr;
+                block = this->file->get(handle.first);
+            }
+            if (selected(block, handle.second, matcher))
+                handles->push_back(handle);
+        }
+    } catch (...) {
+        delete block;
+        delete handles;
+        throw;
+    }
+    delete block;
     return handles;
 }
 
@@ -159,27 +382,125 @@ ValueDict *HeapTable::project(Handle handle) {
 /**
  * Project given columns from a given row.
  * @param handle row to be projected
- * @param column_names of columns to be included in the result
+ * @param column_names of columns to be included in the result (all of them if empty)
  * @return a sequence of values for handle given by column_names
  */
 ValueDict *HeapTable::project(Handle handle, const ColumnNames *column_names) {
-    BlockID block_id = handle.first;
-    RecordID record_id = handle.second;
-    SlottedPage *block = file.get(block_id);
-    Dbt *data = block->get(record_id);
-    ValueDict *row = unmarshal(data);
-    delete data;
+    ColumnOrdinals *columns = get_column_ordinals(column_names->empty() ? this->column_names : *column_names);
+    ValueDict *values;
+    try {
+        Row *row = project_row(handle, *columns);
+        values = to_value_dict(*row, *columns);
+        delete row;
+    } catch (...) {
+        delete columns;
+        throw;
+    }
+    delete columns;
+    return values;
+}
+
+/**
+ * Project given columns from a given row, by position.
+ * @param handle   row to be projected
+ * @param columns  which columns, from get_column_ordinals()
+ * @return         the row's values in the order of columns (freed by caller)
+ */
+Row *HeapTable::project_row(Handle handle, const ColumnOrdinals &columns) {
+    DbBlock *block = this->file->get(handle.first);
+    Row *row;
+    try {
+        row = project_row(block, handle.second, columns);
+    } catch (...) {
+        delete block;
+        throw;
+    }
     delete block;
-    if (column_names->empty())
-        return row;
-    ValueDict *result = new ValueDict();
-    for (auto const &column_name: *column_names) {
-        if (row->find(column_name) == row->end())
-            throw DbRelationError("table does not have column named '" + column_name + "'");
-        (*result)[column_name] = (*row)[column_name];
+    return row;
+}
+
+/**
+ * Project all columns from each of a list of rows.
+ * @param handles  rows to be projected
+ * @return         their values (freed by caller)
+ */
+ValueDicts *HeapTable::project(Handles *handles) {
+    return project(handles, &this->column_names);
+}
+
+/**
+ * Project given columns from each of a list of rows, getting each block only once for all of its rows that
+ * are next to each other in the list (as they are in a list from select()).
+ * @param handles       rows to be projected
+ * @param column_names  columns to be included in the results
+ * @return              their values (freed by caller)
+ */
+ValueDicts *HeapTable::project(Handles *handles, const ColumnNames *column_names) {
+    prefetch(handles);
+    ColumnOrdinals *columns = get_column_ordinals(*column_names);
+    ValueDicts *rows = new ValueDicts();
+    DbBlock *block = nullptr;
+    try {
+        for (auto const &handle: *handles) {
+            if (block == nullptr || block->get_block_id() != handle.first) {
+                delete block;
+                block = nullptr;
+                block = this->file->get(handle.first);
+            }
+            Row *row = project_row(block, handle.second, *columns);
+            rows->push_back(to_value_dict(*row, *columns));
+            delete row;
+        }
+    } catch (...) {
+        delete block;
+        delete columns;
+        for (auto row: *rows)
+            delete row;
+        delete rows;
+        throw;
     }
-    delete row;
-    return result;
+    delete block;
+    delete columns;
+    return rows;
+}
+
+/**
+ * Project given columns from a row in a block we already have, following its forwarding stub if it has
+ * been moved.
+ * @param block      the row's home block
+ * @param record_id  the row's record id there
+ * @param columns    which columns, from get_column_ordinals()
+ * @return           the row's values in the order of columns (freed by caller)
+ */
+Row *HeapTable::project_row(const DbBlock *block, RecordID record_id, const ColumnOrdinals &columns) {
+    BlockID moved_block_id;
+    RecordID moved_record_id;
+    if (!block->get_forward(record_id, moved_block_id, moved_record_id))
+        return unmarshal(block, record_id, columns);
+    open_overflow();
+    DbBlock *moved = this->overflow.get(moved_block_id);
+    Row *row;
+    try {
+        row = unmarshal(moved, moved_record_id, columns);
+    } catch (...) {
+        delete moved;
+        throw;
+    }
+    delete moved;
+    return row;
+}
+
+/**
+ * Have the table's file start reading in the home blocks of some rows.
+ * @param handles  the rows
+ */
+void HeapTable::prefetch(const Handles *handles) {
+    open();
+    BlockIDs block_ids;
+    block_ids.reserve(handles->size());
+    for (auto const &handle: *handles)
+        block_ids.push_back(handle.first);
+    this->file->prefetch(block_ids);
 }
 
 /**
@@ -203,67 +524,83 @@ ValueDict *HeapTable::validate(const ValueDict *row) const {
 }
 
 /**
- * Appends a record to the file.
+ * Appends a record to the file (into a block freed up by deletes if there is one).
  * @param row to be appended
  * @return handle of newly inserted row
  */
 Handle HeapTable::append(const ValueDict *row) {
     Dbt *data = marshal(row);
-    SlottedPage *block = this->file.get(this->file.get_last_block_id());
-    RecordID record_id;
+    Handles handles;
     try {
-        record_id = block->add(data);
-    } catch (DbBlockNoRoomError &e) {
-        // need a new block
-        delete block;
-        block = this->file.get_new();
-        record_id = block->add(data);
+        this->file->append(data, 1, handles);
+    } catch (...) {
+        if (handles.empty())
+            del_overflow(RecordView(data->get_data(), data->get_size()));
+        delete[] (char *) data->get_data();
+        delete data;
+        throw;
     }
-    this->file.put(block);
-    delete block;
     delete[] (char *) data->get_data();
     delete data;
-    return Handle(this->file.get_last_block_id(), record_id);
+    return handles[0];
 }
 
 /**
- * Figure out the bits to go into the file.
+ * Figure out the bits to go into the file, in the table's row format.
+ * Long TEXT values are written out to the overflow file here and only a pointer to them goes into the row.
  * The caller is responsible for freeing the returned Dbt and its enclosed ret->get_data().
  * @param row data for the tuple
  * @return bits of the record as it should appear on disk
  */
-Dbt *HeapTable::marshal(const ValueDict *row) const {
-    char *bytes = new char[DbBlock::BLOCK_SZ]; // more than we need (we insist that one row fits into DbBlock::BLOCK_SZ)
+Dbt *HeapTable::marshal(const ValueDict *row) {
+    uint block_size = this->file->get_block_size();
+    char *bytes = new char[block_size]; // more than we need (we insist that one row fits into a block)
     uint offset = 0;
-    uint col_num = 0;
-    for (auto const &column_name: this->column_names) {
-        ColumnAttribute ca = this->column_attributes[col_num++];
-        ValueDict::const_iterator column = row->find(column_name);
-        Value value = column->second;
-
-        if (ca.get_data_type() == ColumnAttribute::DataType::INT) {
-            if (offset + 4 > DbBlock::BLOCK_SZ - 4)
-                throw DbRelationError("row too big to marshal");
-            *(int32_t *) (bytes + offset) = value.n;
-            offset += sizeof(int32_t);
-        } else if (ca.get_data_type() == ColumnAttribute::DataType::TEXT) {
-            u_long size = value.s.length();
-            if (size > UINT16_MAX)
-                throw DbRelationError("text field too long to marshal");
-            if (offset + 2 + size > DbBlock::BLOCK_SZ)
-                throw DbRelationError("row too big to marshal");
-            *(u16 *) (bytes + offset) = size;
-            offset += sizeof(u16);
-            memcpy(bytes + offset, value.s.c_str(), size); // assume ascii for now
-            offset += size;
-        } else if (ca.get_data_type() == ColumnAttribute::DataType::BOOLEAN) {
-            if (offset + 1 > DbBlock::BLOCK_SZ - 1)
-                throw DbRelationError("row too big to marshal");
-            *(uint8_t *) (bytes + offset) = (uint8_t) value.n;
-            offset += sizeof(uint8_t);
+    vector<uint> text_offsets;  // where the TEXT values marshaled so far are, to free their chunks on failure
+    try {
+        if (this->row_format == ROW_FORMAT_1) {
+            uint col_num = 0;
+            for (auto const &column_name: this->column_names) {
+                ColumnAttribute ca = this->column_attributes[col_num++];
+                uint start = offset;
+                offset = marshal_value(ca.get_data_type(), row->find(column_name)->second, bytes, offset);
+                if (ca.get_data_type() == ColumnAttribute::DataType::TEXT)
+                    text_offsets.push_back(start);
+            }
         } else {
-            throw DbRelationError("Only know how to marshal INT, TEXT, and BOOLEAN");
+            // the fixed-width columns go right after the TEXT offsets (at their locations), then the TEXT columns
+            uint text_offsets_size = 0;
+            for (ColumnAttribute ca: this->column_attributes)
+                if (ca.get_data_type() == ColumnAttribute::DataType::TEXT)
+                    text_offsets_size += sizeof(u16);
+            offset = text_offsets_size;
+            for (bool text: {false, true}) {
+                uint col_num = 0;
+                for (auto const &column_name: this->column_names) {
+                    uint column = col_num++;
+                    ColumnAttribute::DataType data_type = this->column_attributes[column].get_data_type();
+                    if ((data_type == ColumnAttribute::DataType::TEXT) != text)
+                        continue;
+                    uint start = offset;
+                    if (text)
+                        *(u16 *) (bytes + this->locations[column]) = (u16) offset;
+                    offset = marshal_value(data_type, row->find(column_name)->second, bytes, offset);
+                    if (text)
+                        text_offsets.push_back(start);
+                }
+            }
         }
+    } catch (...) {
+        // the row is never stored, so the chunks of its out-of-line values would be lost
+        for (uint text_offset: text_offsets) {
+            if (*(const u16 *) (bytes + text_offset) != OVERFLOW_MARKER)
+                continue;
+            const char *pointer = bytes + text_offset + sizeof(u16);
+            del_overflow_chunks(*(const BlockID *) (pointer + sizeof(u32)),
+                                *(const RecordID *) (pointer + sizeof(u32) + sizeof(BlockID)));
+        }
+        delete[] bytes;
+        throw;
     }
     char *right_size_bytes = new char[offset];
     memcpy(right_size_bytes, bytes, offset);
@@ -273,56 +610,498 @@ Dbt *HeapTable::marshal(const ValueDict *row) const {
 }
 
 /**
- * Figure out the memory data structures from the given bits gotten from the file.
- * @param data file data for the tuple
- * @return row data for the tuple
+ * Figure out the bits of one column's value.
+ * @param data_type  the column's data type
+ * @param value      the column's value
+ * @param bytes      the row being marshaled (a block's worth of room)
+ * @param offset     where the column's bits go
+ * @return           where the next column's bits can go
+ * @throws DbRelationError if the row doesn't fit in a block
  */
-ValueDict *HeapTable::unmarshal(Dbt *data) const {
-    ValueDict *row = new ValueDict();
-    Value value;
-    char *bytes = (char *) data->get_data();
-    uint offset = 0;
-    uint col_num = 0;
-    for (auto const &column_name: this->column_names) {
-        ColumnAttribute ca = this->column_attributes[col_num++];
-        value.data_type = ca.get_data_type();
-        if (ca.get_data_type() == ColumnAttribute::DataType::INT) {
-            value.n = *(int32_t *) (bytes + offset);
-            offset += sizeof(int32_t);
-        } else if (ca.get_data_type() == ColumnAttribute::DataType::TEXT) {
-            u16 size = *(u16 *) (bytes + offset);
+uint HeapTable::marshal_value(ColumnAttribute::DataType data_type, const Value &value, char *bytes, uint offset) {
+    uint block_size = this->file->get_block_size();
+    if (data_type == ColumnAttribute::DataType::INT) {
+        if (offset + 4 > block_size - 4)
+            throw DbRelationError("row too big to marshal");
+        *(int32_t *) (bytes + offset) = value.n;
+        offset += sizeof(int32_t);
+    } else if (data_type == ColumnAttribute::DataType::TEXT) {
+        u_long size = value.s.length();
+        if (size > block_size / 8) {
+            if (offset + 2 + OVERFLOW_POINTER_SZ > block_size)
+                throw DbRelationError("row too big to marshal");
+            *(u16 *) (bytes + offset) = OVERFLOW_MARKER;
             offset += sizeof(u16);
-            char buffer[DbBlock::BLOCK_SZ];
-            memcpy(buffer, bytes + offset, size);
-            buffer[size] = '\0';
-            value.s = string(buffer);  // assume ascii for now
-            offset += size;
-        } else if (ca.get_data_type() == ColumnAttribute::DataType::BOOLEAN) {
-            value.n = *(uint8_t *) (bytes + offset);
-            offset += sizeof(uint8_t);
+            put_overflow(value.s, bytes + offset);
+            offset += OVERFLOW_POINTER_SZ;
+            return offset;
+        }
+        if (offset + 2 + size > block_size)
+            throw DbRelationError("row too big to marshal");
+        *(u16 *) (bytes + offset) = size;
+        offset += sizeof(u16);
+        memcpy(bytes + offset, value.s.c_str(), size); // assume ascii for now
+        offset += size;
+    } else if (data_type == ColumnAttribute::DataType::BOOLEAN) {
+        if (offset + 1 > block_size - 1)
+            throw DbRelationError("row too big to marshal");
+        *(uint8_t *) (bytes + offset) = (uint8_t) value.n;
+        offset += sizeof(uint8_t);
+    } else {
+        throw DbRelationError("Only know how to marshal INT, TEXT, and BOOLEAN");
+    }
+    return offset;
+}
+
+/**
+ * Figure out the memory data structures for some columns of a record in the given block.
+ * Each column is decoded straight from where it is (its minipage in a PaxPage, or its spot in a ROW_FORMAT_2
+ * row), so the columns that aren't wanted are never touched. A ROW_FORMAT_1 row is walked just once, as far as
+ * the last column wanted.
+ * @param block      block holding the record (not a forwarding stub)
+ * @param record_id  which record
+ * @param columns    which columns, from get_column_ordinals()
+ * @return           the values of the columns, in the same order (freed by caller)
+ * @throws DbRelationError if the record has been deleted
+ */
+Row *HeapTable::unmarshal(const DbBlock *block, RecordID record_id, const ColumnOrdinals &columns) {
+    const PaxPage *pax = dynamic_cast<const PaxPage *>(block);
+    const char *bytes = pax == nullptr ? block->view(record_id).get_data() : nullptr;
+    if ((pax == nullptr ? bytes : pax->view_field(record_id, 0).get_data()) == nullptr)
+        throw DbRelationError("row has been deleted");
+    vector<const char *> starts;  // ROW_FORMAT_1: where each column starts, as far as has been walked
+    Row *row = new Row(columns.size());
+    for (size_t i = 0; i < columns.size(); i++) {
+        uint column = columns[i];
+        const char *bits;
+        if (pax != nullptr) {
+            bits = pax->view_field(record_id, column).get_data();
+        } else if (this->row_format == ROW_FORMAT_2) {
+            bits = field(bytes, column);
         } else {
-            throw DbRelationError("Only know how to unmarshal INT, TEXT, and BOOLEAN");
+            if (starts.empty())
+                starts.push_back(bytes);
+            while (starts.size() <= column) {
+                ColumnAttribute ca = this->column_attributes[starts.size() - 1];
+                starts.push_back(starts.back() + field_size(ca.get_data_type(), starts.back()));
+            }
+            bits = starts[column];
+        }
+        Value &value = (*row)[i];
+        value.data_type = this->column_attributes[column].get_data_type();
+        try {
+            unmarshal_value(value.data_type, bits, value);
+        } catch (...) {
+            delete row;
+            throw;
         }
-        (*row)[column_name] = value;
     }
     return row;
 }
 
 /**
- * See if the row at the given handle satisfies the given where clause
- * @param handle  row to check
- * @param where   conditions to check
- * @return        true if conditions met, false otherwise
+ * Figure out one column's value from its bits.
+ * @param data_type  the column's data type
+ * @param bytes      where the column's bits start
+ * @param value      set to the column's value
  */
-bool HeapTable::selected(Handle handle, const ValueDict *where) {
-    if (where == nullptr)
+void HeapTable::unmarshal_value(ColumnAttribute::DataType data_type, const char *bytes, Value &value) {
+    if (data_type == ColumnAttribute::DataType::INT) {
+        value.n = *(const int32_t *) bytes;
+    } else if (data_type == ColumnAttribute::DataType::TEXT) {
+        u16 size = *(const u16 *) bytes;
+        if (size == OVERFLOW_MARKER)
+            value.s = get_overflow(bytes + sizeof(u16));
+        else
+            value.s.assign(bytes + sizeof(u16), size);  // assume ascii for now
+    } else if (data_type == ColumnAttribute::DataType::BOOLEAN) {
+        value.n = *(const uint8_t *) bytes;
+    } else {
+        throw DbRelationError("Only know how to unmarshal INT, TEXT, and BOOLEAN");
+    }
+}
+
+/**
+ * Find where a column's bits are in a marshaled row.
+ * @param bytes   the row's bits (not a PaxPage record's)
+ * @param column  which column
+ * @return        where the column's bits start
+ */
+const char *HeapTable::field(const char *bytes, uint column) const {
+    if (this->row_format == ROW_FORMAT_1) {
+        uint offset = 0;
+        for (uint before = 0; before < column; before++) {
+            ColumnAttribute ca = this->column_attributes[before];
+            offset += field_size(ca.get_data_type(), bytes + offset);
+        }
+        return bytes + offset;
+    }
+    u16 location = this->locations[column];
+    ColumnAttribute ca = this->column_attributes[column];
+    if (ca.get_data_type() == ColumnAttribute::DataType::TEXT)
+        return bytes + *(const u16 *) (bytes + location);
+    return bytes + location;
+}
+
+/**
+ * Find out how many bytes a column's bits take up in a row.
+ * @param data_type  the column's data type
+ * @param bytes      where the column's bits start
+ * @return           number of bytes
+ */
+uint HeapTable::field_size(ColumnAttribute::DataType data_type, const char *bytes) {
+    if (data_type == ColumnAttribute::DataType::INT)
+        return sizeof(int32_t);
+    if (data_type == ColumnAttribute::DataType::BOOLEAN)
+        return sizeof(uint8_t);
+    u16 size = *(const u16 *) bytes;
+    return sizeof(u16) + (size == OVERFLOW_MARKER ? OVERFLOW_POINTER_SZ : size);
+}
+
+/**
+ * Switch to marshaling rows in the given format, working out where each column goes in it.
+ * @param row_format  ROW_FORMAT_1 or ROW_FORMAT_2
+ */
+void HeapTable::set_row_format(u16 row_format) {
+    this->row_format = row_format;
+    this->locations.clear();
+    u16 fixed = 0;  // the fixed-width columns start right after the TEXT offsets
+    for (ColumnAttribute ca: this->column_attributes)
+        if (ca.get_data_type() == ColumnAttribute::DataType::TEXT)
+            fixed += sizeof(u16);
+    u16 text = 0;
+    for (ColumnAttribute ca: this->column_attributes) {
+        if (ca.get_data_type() == ColumnAttribute::DataType::TEXT) {
+            this->locations.push_back(text);
+            text += sizeof(u16);
+        } else {
+            this->locations.push_back(fixed);
+            fixed += ca.get_data_type() == ColumnAttribute::DataType::INT ? sizeof(int32_t) : sizeof(uint8_t);
+        }
+    }
+}
+
+/**
+ * Make sure the overflow file is open, creating it the first time it is needed.
+ */
+void HeapTable::open_overflow() {
+    try {
+        overflow.open();
+    } catch (DbException &e) {
+        overflow.create();
+    }
+}
+
+/**
+ * Write a long TEXT value out to the overflow file as a chain of chunks.
+ * The chunks are written last to first so each one can point at the one after it.
+ * @param value    the TEXT value
+ * @param pointer  where to put the value's length and the handle of its first chunk
+ *                 (OVERFLOW_POINTER_SZ bytes)
+ */
+void HeapTable::put_overflow(const string &value, char *pointer) {
+    open_overflow();
+    u32 size = (u32) value.length();
+    u32 chunk_size = overflow.get_block_size() - OVERFLOW_CHUNK_HEADER_SZ - OVERFLOW_SLACK;
+    char *chunk = new char[OVERFLOW_CHUNK_HEADER_SZ + chunk_size];
+    BlockID next_block_id = 0;
+    RecordID next_record_id = 0;
+    for (u32 start = (size - 1) / chunk_size * chunk_size;; start -= chunk_size) {
+        u32 n = min(chunk_size, size - start);
+        *(BlockID *) chunk = next_block_id;
+        *(RecordID *) (chunk + sizeof(BlockID)) = next_record_id;
+        memcpy(chunk + OVERFLOW_CHUNK_HEADER_SZ, value.data() + start, n);
+        Dbt data(chunk, OVERFLOW_CHUNK_HEADER_SZ + n);
+
+        DbBlock *block = nullptr;
+        try {
+            block = overflow.get(overflow.get_last_block_id());
+            try {
+                next_record_id = block->add(&data);
+            } catch (DbBlockNoRoomError &e) {
+                delete block;
+                block = nullptr;
+                block = overflow.get_new();
+                next_record_id = block->add(&data);
+            }
+            next_block_id = block->get_block_id();
+            overflow.put(block);
+        } catch (...) {
+            delete block;
+            delete[] chunk;
+            del_overflow_chunks(next_block_id, next_record_id);  // the ones after this chunk are already written
+            throw;
+        }
+        delete block;
+        if (start == 0)
+            break;
+    }
+    delete[] chunk;
+    *(u32 *) pointer = size;
+    *(BlockID *) (pointer + sizeof(u32)) = next_block_id;
+    *(RecordID *) (pointer + sizeof(u32) + sizeof(BlockID)) = next_record_id;
+}
+
+/**
+ * Read a long TEXT value back in from the overflow file.
+ * @param pointer  the value's length and the handle of its first chunk, as written by put_overflow()
+ * @return         the TEXT value
+ */
+string HeapTable::get_overflow(const char *pointer) {
+    open_overflow();
+    string value;
+    value.reserve(*(const u32 *) pointer);
+    BlockID block_id = *(const BlockID *) (pointer + sizeof(u32));
+    RecordID record_id = *(const RecordID *) (pointer + sizeof(u32) + sizeof(BlockID));
+    while (block_id != 0) {
+        DbBlock *block = overflow.get(block_id);
+        RecordView chunk = block->view(record_id);
+        block_id = *(const BlockID *) chunk.get_data();
+        record_id = *(const RecordID *) (chunk.get_data() + sizeof(BlockID));
+        value.append(chunk.get_data() + OVERFLOW_CHUNK_HEADER_SZ, chunk.get_size() - OVERFLOW_CHUNK_HEADER_SZ);
+        delete block;
+    }
+    return value;
+}
+
+/**
+ * Delete the overflow chunks of any out-of-line TEXT values in the given row.
+ * @param data  file data for the tuple (a null view for a deleted one)
+ */
+void HeapTable::del_overflow(RecordView data) {
+    const char *bytes = data.get_data();
+    if (bytes == nullptr)
+        return;  // a deleted row has none
+    uint offset = 0;
+    uint column = 0;
+    for (ColumnAttribute ca: this->column_attributes) {
+        const char *bits = this->row_format == ROW_FORMAT_1 ? bytes + offset : field(bytes, column);
+        column++;
+        offset += field_size(ca.get_data_type(), bits);
+        if (ca.get_data_type() != ColumnAttribute::DataType::TEXT || *(const u16 *) bits != OVERFLOW_MARKER)
+            continue;
+        const char *pointer = bits + sizeof(u16);
+        del_overflow_chunks(*(const BlockID *) (pointer + sizeof(u32)),
+                            *(const RecordID *) (pointer + sizeof(u32) + sizeof(BlockID)));
+    }
+}
+
+/**
+ * Delete a chain of overflow chunks.
+ * @param block_id   where the first chunk is (0 for none)
+ * @param record_id
+ */
+void HeapTable::del_overflow_chunks(BlockID block_id, RecordID record_id) {
+    if (block_id == 0)
+        return;
+    open_overflow();
+    while (block_id != 0) {
+        DbBlock *block = overflow.get(block_id);
+        RecordView chunk = block->view(record_id);
+        BlockID next_block_id = *(const BlockID *) chunk.get_data();
+        RecordID next_record_id = *(const RecordID *) (chunk.get_data() + sizeof(BlockID));
+        block->del(record_id);
+        overflow.put(block);
+        delete block;
+        block_id = next_block_id;
+        record_id = next_record_id;
+    }
+}
+
+/**
+ * See if a row in a block we already have matches, checking it right on its bytes.
+ * @param block      the row's home block
+ * @param record_id  the row's record id there
+ * @param matcher    predicates to match, compiled for this table
+ * @return           true if it matches
+ */
+bool HeapTable::selected(const DbBlock *block, RecordID record_id, const RowMatcher &matcher) {
+    if (matcher.matches_everything())
         return true;
-    ValueDict *row = this->project(handle, where);
-    bool is_selected = *row == *where;
-    delete row;
+    BlockID moved_block_id;
+    RecordID moved_record_id;
+    if (!block->get_forward(record_id, moved_block_id, moved_record_id))
+        return matcher.matches(block, record_id);
+    open_overflow();
+    DbBlock *moved = this->overflow.get(moved_block_id);
+    bool is_selected;
+    try {
+        is_selected = matcher.matches(moved, moved_record_id);
+    } catch (...) {
+        delete moved;
+        throw;
+    }
+    delete moved;
     return is_selected;
 }
 
+/**
+ * Get the block where a row actually is, following its forwarding stub if it has been moved.
+ * @param handle     row to find
+ * @param record_id  set to the row's record id in the returned block
+ * @return           block from the table's file or from the side file (freed by caller)
+ */
+DbBlock *HeapTable::locate(Handle handle, RecordID &record_id) {
+    record_id = handle.second;
+    DbBlock *block = this->file->get(handle.first);
+    BlockID moved_block_id;
+    if (block->get_forward(handle.second, moved_block_id, record_id)) {
+        delete block;
+        open_overflow();
+        block = this->overflow.get(moved_block_id);
+    }
+    return block;
+}
+
+/**
+ * Move a row that no longer fits in its home block out to the side file.
+ * @param data  the row's marshaled bits
+ * @return      where it went in the side file
+ */
+Handle HeapTable::move_out(const Dbt &data) {
+    open_overflow();
+    Handles moved_handles;
+    this->overflow.append(&data, 1, moved_handles);
+    return moved_handles[0];
+}
+
+/**
+ * Constructor
+ * @param table  the table whose rows are to be checked
+ * @param where  predicates to match (copied), or nullptr for all the rows
+ * @throws DbRelationError if the table doesn't have one of the columns
+ */
+RowMatcher::RowMatcher(HeapTable &table, const ValueDict *where)
+        : table(table), data_types(), tests(), never(false) {
+    if (where == nullptr)
+        return;
+    const ColumnNames &column_names = table.get_column_names();
+    ColumnAttributes column_attributes = table.get_column_attributes();
+    for (auto const &predicate: *where) {
+        auto found = find(column_names.begin(), column_names.end(), predicate.first);
+        if (found == column_names.end())
+            throw DbRelationError("table does not have column named '" + predicate.first + "'");
+        Test test;
+        test.column = (uint) (found - column_names.begin());
+        test.data_type = column_attributes[test.column].get_data_type();
+        test.n = predicate.second.n;
+        test.s = predicate.second.s;
+        if (predicate.second.data_type != test.data_type)
+            this->never = true;  // a value of another type is never equal
+        this->tests.push_back(test);
+    }
+    sort(this->tests.begin(), this->tests.end(),
+         [](const Test &a, const Test &b) { return a.column < b.column; });
+    if (!this->tests.empty())
+        for (uint column = 0; column <= this->tests.back().column; column++)
+            this->data_types.push_back(column_attributes[column].get_data_type());
+}
+
+/**
+ * Check a record.
+ * @param block      the block the record is in (not a forwarding stub)
+ * @param record_id  the record
+ * @return           true if it passes every test
+ */
+bool RowMatcher::matches(const DbBlock *block, RecordID record_id) const {
+    if (this->never)
+        return false;
+    const PaxPage *pax = dynamic_cast<const PaxPage *>(block);
+    if (pax != nullptr) {
+        for (auto const &test: this->tests)
+            if (!passes(test, pax->view_field(record_id, test.column).get_data()))
+                return false;
+        return true;
+    }
+    const char *bytes = block->view(record_id).get_data();
+    if (this->table.row_format == HeapTable::ROW_FORMAT_2) {
+        for (auto const &test: this->tests)
+            if (!passes(test, this->table.field(bytes, test.column)))
+                return false;
+        return true;
+    }
+    uint offset = 0;
+    size_t next = 0;
+    for (uint column = 0; next < this->tests.size(); column++) {
+        if (this->tests[next].column == column && !passes(this->tests[next++], bytes + offset))
+            return false;
+        offset += HeapTable::field_size(this->data_types[column], bytes + offset);
+    }
+    return true;
+}
+
+/**
+ * Check one column's bits.
+ * @param test   the test for the column
+ * @param bytes  where the column's bits start
+ * @return       true if they are equal to the test's value
+ */
+bool RowMatcher::passes(const Test &test, const char *bytes) const {
+    if (test.data_type == ColumnAttribute::DataType::INT)
+        return *(const int32_t *) bytes == test.n;
+    if (test.data_type == ColumnAttribute::DataType::BOOLEAN)
+        return *(const uint8_t *) bytes == (uint8_t) test.n;
+    u16 size = *(const u16 *) bytes;
+    if (size != OVERFLOW_MARKER)
+        return size == test.s.size() && memcmp(bytes + sizeof(u16), test.s.data(), size) == 0;
+    // out of line: the pointer starts with the length, so most values never have to be fetched
+    const char *pointer = bytes + sizeof(u16);
+    return *(const u32 *) pointer == test.s.size() && this->table.get_overflow(pointer) == test.s;
+}
+
+/**
+ * Constructor
+ * @param table  the table to scan (open)
+ * @param where  predicates to match (copied), or nullptr for all the rows
+ */
+HeapTableCursor::HeapTableCursor(HeapTable &table, const ValueDict *where)
+        : table(table), matcher(table, where), scan(nullptr), block(nullptr), record_id(0) {
+    this->scan = table.file->scan(table.file->block_ids());
+}
+
+HeapTableCursor::~HeapTableCursor() {
+    delete this->block;
+    delete this->scan;
+}
+
+/**
+ * Get the next row that matches, reading the next block of the table when this one runs out.
+ * @param handle  set to the row
+ * @return        false once there are no more
+ */
+bool HeapTableCursor::next(Handle &handle) {
+    while (this->scan != nullptr) {
+        if (this->block != nullptr) {
+            while ((this->record_id = this->block->next_id(this->record_id)) != 0) {
+                if (this->table.selected(this->block, this->record_id, this->matcher)) {
+                    handle = Handle(this->block->get_block_id(), this->record_id);
+                    return true;
+                }
+            }
+            delete this->block;  // before the scan's next(), which may reuse its memory
+            this->block = nullptr;
+        }
+        this->block = this->scan->next();
+        this->record_id = 0;
+        if (this->block == nullptr) {
+            delete this->scan;
+            this->scan = nullptr;
+        }
+    }
+    return false;
+}
+
+/**
+ * Project the row next() just found, right from the block the scan has.
+ * @param columns  which columns, from the table's get_column_ordinals()
+ * @return         the row's values in the order of columns (freed by caller)
+ */
+Row *HeapTableCursor::project_row(const ColumnOrdinals &columns) {
+    if (this->block == nullptr || this->record_id == 0)
+        throw DbRelationError("cursor is not on a row");
+    return this->table.project_row(this->block, this->record_id, columns);
+}
+
 /**
  * Test helper. Sets the row's a and b values.
  * @param row to set
@@ -371,6 +1150,9 @@ bool test_heap_storage() {
     if (!test_slotted_page())
         return assertion_failure("slotted page tests failed");
     cout << endl << "slotted page tests ok" << endl;
+    if (!test_pax_page())
+        return assertion_failure("pax page tests failed");
+    cout << "pax page tests ok" << endl;
 
     ColumnNames column_names;
     column_names.push_back("a");
@@ -431,7 +1213,739 @@ bool test_heap_storage() {
             return false;
     }
     cout << "del ok" << endl;
-    table.drop();
+
+    ValueDict just_500;
+    just_500["a"] = Value(500);
+    SelectCursor *cursor = table.select_cursor(&just_500);
+    Handle found;
+    bool cursor_ok = cursor->next(found) && found == handles->at(501) && !cursor->next(found);
+    delete cursor;
+    ValueDict same_b;
+    same_b["b"] = Value(b);
+    cursor = table.select_cursor(table.select_cursor(nullptr), &same_b);
+    i = -1;
+    for (Handle handle; cursor->next(handle) && i < 100; i++)  // stopping early, with the rest never read
+        if (!test_compare(table, handle, i, b))
+            cursor_ok = false;
+    delete cursor;
+    if (!cursor_ok || i != 100)
+        return false;
+    cout << "cursor ok" << endl;
+
+    size_t blocks = 0;
+    for (size_t n = 0; n < handles->size(); n++)
+        if (n == 0 || handles->at(n).first != handles->at(n - 1).first)
+            blocks++;
+    ColumnNames a_only = {"a"};
+    ColumnOrdinals *c_then_a = table.get_column_ordinals({"c", "a"});
+    BufferPool &shared_pool = BufferPool::shared();
+    shared_pool.reset_counters();
+    cursor = table.select_cursor(&same_b);
+    i = -1;
+    for (Handle handle; cursor->next(handle); i++) {
+        Row *result = cursor->project_row(*c_then_a);  // from the block the scan already has
+        if (result->size() != 2 || (*result)[0].n != (i % 2 == 0) || (*result)[1].n != i)
+            cursor_ok = false;
+        delete result;
+    }
+    delete cursor;
+    delete c_then_a;
+    if (!cursor_ok || i != 999 || shared_pool.get_hits() + shared_pool.get_misses() > blocks)
+        return false;
+    shared_pool.reset_counters();
+    ValueDicts *projected = table.project(handles, &a_only);  // one get per block, not per row
+    i = -1;
+    for (auto const &result: *projected) {
+        if ((*result)["a"].n != i++)
+            cursor_ok = false;
+        delete result;
+    }
+    delete projected;
+    if (!cursor_ok || shared_pool.get_hits() + shared_pool.get_misses() != blocks)
+        return false;
+    cout << "fused scan ok" << endl;
+
+    Value even(1);
+    even.data_type = ColumnAttribute::BOOLEAN;
+    ValueDict matching;
+    matching["c"] = even;
+    matching["b"] = Value(b);
+    Handles *matched = table.select(&matching);
+    bool matcher_ok = matched->size() == 500 && matched->at(0) == handles->at(1);
+    delete matched;
+    matched = table.select(handles, &matching);
+    matcher_ok = matcher_ok && matched->size() == 500;
+    delete matched;
+    matching["a"] = Value(998);
+    matched = table.select(&matching);
+    matcher_ok = matcher_ok && matched->size() == 1 && matched->at(0) == handles->back();
+    delete matched;
+    matching["a"] = Value("998");  // never equal to an INT
+    matched = table.select(&matching);
+    matcher_ok = matcher_ok && matched->empty();
+    delete matched;
+    matching["no_such_column"] = Value(1);
+    try {
+        delete table.select(&matching);
+        matcher_ok = false;
+    } catch (DbRelationError &e) {
+    }
+    if (!matcher_ok)
+        return false;
+    cout << "matcher ok" << endl;
+
+    // growing every row in the first block can't all fit there, so some have to be moved out
+    ValueDict new_values;
+    string longer_b = b + b;
+    new_values["b"] = Value(longer_b);
+    for (i = 0; i < 30; i++)
+        table.update(handles->at(i), &new_values);
+    for (i = 0; i < 30; i++)
+        if (!test_compare(table, handles->at(i), i - 1, longer_b))
+            return false;
+    Handles *updated_handles = table.select();
+    bool same_handles = *updated_handles == *handles;
+    delete updated_handles;
+    if (!same_handles)
+        return false;
+    new_values["a"] = Value(-3);
+    new_values["b"] = Value(b);
+    table.update(handles->at(0), &new_values);  // moved back home
+    new_values.erase("b");
+    new_values["a"] = Value(0);
+    table.update(handles->at(1), &new_values);  // in place, wherever it is
+    table.del(handles->at(2));
+    if (!test_compare(table, handles->at(0), -3, b) || !test_compare(table, handles->at(1), 0, longer_b))
+        return false;
+    updated_handles = table.select();
+    same_handles = updated_handles->size() == 999 && updated_handles->at(2) == handles->at(3);
+    delete updated_handles;
+    if (!same_handles)
+        return false;
+    cout << "update ok" << endl;
+
+    // space freed by deletes is found again through the free space map, even after reopening
+    BlockID last_block_id = handles->back().first;
+    for (i = 3; i < 103; i++)
+        table.del(handles->at(i));
+    delete handles;
+    table.close();
+    for (i = 0; i < 100; i++) {
+        test_set_row(row, 2000 + i, b);
+        Handle handle = table.insert(&row);
+        if (handle.first >= last_block_id || !test_compare(table, handle, 2000 + i, b))
+            return assertion_failure("insert did not reuse free space", handle.first, last_block_id);
+    }
+    handles = table.select();
+    if (handles->size() != 999 || handles->back().first != last_block_id)
+        return false;
+    cout << "free space reuse ok" << endl;
+    delete handles;
+
+    HeapTable big_table("_test_big_blocks_cpp", column_names, column_attributes, DbBlock::MAX_BLOCK_SZ);
+    big_table.create();
+    string long_b(10000, 'x');
+    test_set_row(row, 7, long_b);
+    Handle big_handle = big_table.insert(&row);
+    if (!test_compare(big_table, big_handle, 7, long_b))
+        return false;
+    big_table.drop();
+    cout << "big blocks ok" << endl;
+
+    HeapTable overflow_table("_test_overflow_cpp", column_names, column_attributes);
+    overflow_table.create();
+    string huge_b(20000, 'y');
+    huge_b[0] = 'Y';
+    huge_b[19999] = 'Z';
+    test_set_row(row, 8, huge_b);
+    Handle overflow_handle = overflow_table.insert(&row);
+    test_set_row(row, 9, b);
+    overflow_table.insert(&row);
+    if (!test_compare(overflow_table, overflow_handle, 8, huge_b))
+        return false;
+    ColumnNames just_a(1, "a");
+    ValueDict *result = overflow_table.project(overflow_handle, &just_a);
+    bool only_a = result->size() == 1 && result->at("a") == Value(8);
+    delete result;
+    if (!only_a)
+        return false;
+    ValueDict huge_where;
+    huge_where["b"] = Value(huge_b);  // out of line, so its length is checked before it is fetched
+    handles = overflow_table.select(&huge_where);
+    bool huge_found = handles->size() == 1 && handles->at(0) == overflow_handle;
+    delete handles;
+    huge_where["b"] = Value(huge_b.substr(1) + "Y");  // same length, different bytes
+    handles = overflow_table.select(&huge_where);
+    huge_found = huge_found && handles->empty();
+    delete handles;
+    if (!huge_found)
+        return false;
+    overflow_table.del(overflow_handle);
+    handles = overflow_table.select();
+    if (handles->size() != 1 || !test_compare(overflow_table, handles->at(0), 9, b))
+        return false;
     delete handles;
+    overflow_table.drop();
+
+    // a moved row with an out-of-line TEXT value takes its chunks with it when it is deleted
+    ColumnNames texts = {"x", "y"};
+    ColumnAttributes text_attributes(2, ColumnAttribute(ColumnAttribute::TEXT));
+    HeapTable moved_table("_test_moved_overflow_cpp", texts, text_attributes);
+    moved_table.create();
+    ValueDict text_row;
+    text_row["x"] = Value(string(300, 'x'));
+    text_row["y"] = Value("y");
+    Handles moved_handles;
+    for (i = 0; i < 13; i++)  // fills the first block
+        moved_handles.push_back(moved_table.insert(&text_row));
+    if (moved_handles.back().first != 1)
+        return assertion_failure("first block didn't hold 13 rows", moved_handles.back().first);
+    text_row["x"] = Value(string(500, 'X'));
+    text_row["y"] = Value(string(600, 'Y'));  // one chunk, which the moved row then goes in with
+    moved_table.update(moved_handles[0], &text_row);  // too big for its block now, so moved
+    BlockID moved_block_id;
+    RecordID moved_record_id;
+    DbBlock *home = moved_table.file->get(1);
+    bool is_moved = home->get_forward(moved_handles[0].second, moved_block_id, moved_record_id);
+    delete home;
+    if (!is_moved || moved_table.overflow.get_last_block_id() != 1)
+        return assertion_failure("row wasn't moved in with its chunk", moved_block_id);
+    moved_table.del(moved_handles[0]);
+    for (BlockID block_id: moved_table.overflow.block_ids()) {
+        DbBlock *block = moved_table.overflow.get(block_id);
+        RecordIDs *ids = block->ids();
+        bool empty = block->size() == 0 && ids->empty();
+        delete ids;
+        delete block;
+        if (!empty)
+            return assertion_failure("overflow block left with records", block_id);
+    }
+    moved_table.drop();
+
+    // a row that turns out to be too big only after an out-of-line value was written leaves no chunks behind
+    ColumnNames wide_names;
+    ValueDict wide_row;
+    for (char c = 'a'; c <= 'j'; c++) {
+        wide_names.push_back(string(1, c));
+        wide_row[string(1, c)] = Value(string(c == 'a' ? 600 : 500, c));  // a is out of line, the rest aren't
+    }
+    HeapTable wide_table("_test_wide_cpp", wide_names, ColumnAttributes(10, ColumnAttribute(ColumnAttribute::TEXT)));
+    wide_table.create();
+    bool too_big = false;
+    try {
+        wide_table.insert(&wide_row);
+    } catch (DbRelationError &e) {
+        too_big = true;
+    }
+    if (!too_big)
+        return assertion_failure("row too big for a block was inserted");
+    for (BlockID block_id: wide_table.overflow.block_ids()) {
+        DbBlock *block = wide_table.overflow.get(block_id);
+        RecordIDs *ids = block->ids();
+        bool empty = ids->empty();
+        delete ids;
+        delete block;
+        if (!empty)
+            return assertion_failure("too-big row left overflow chunks", block_id);
+    }
+    // a batch goes in whole or not at all, even when it is the file rather than marshal() that says no
+    ValueDicts wide_rows;
+    wide_rows.push_back(new ValueDict());
+    wide_rows.push_back(new ValueDict());
+    for (char c = 'a'; c <= 'j'; c++) {
+        (*wide_rows[0])[string(1, c)] = Value(string(1, c));
+        (*wide_rows[1])[string(1, c)] = Value(string(c <= 'h' ? 506 : 1, c));  // marshals, but no block holds it
+    }
+    too_big = false;
+    try {
+        delete wide_table.insert_batch(&wide_rows);
+    } catch (DbBlockNoRoomError &e) {
+        too_big = true;
+    }
+    for (ValueDict *wide: wide_rows)
+        delete wide;
+    if (!too_big)
+        return assertion_failure("batch with a row too big for a block was inserted");
+    handles = wide_table.select();
+    size_t left = handles->size();
+    delete handles;
+    if (left != 0)
+        return assertion_failure("failed batch left rows behind", left);
+    wide_table.drop();
+
+    // a row shorter than a forwarding stub can still be moved out of a full block
+    HeapTable short_table("_test_short_cpp", ColumnNames(1, "t"),
+                          ColumnAttributes(1, ColumnAttribute(ColumnAttribute::TEXT)));
+    short_table.create();
+    ValueDict short_row;
+    short_row["t"] = Value("");  // 4 bytes marshaled: its offset and its length
+    Handles short_handles;
+    do
+        short_handles.push_back(short_table.insert(&short_row));
+    while (short_handles.back().first == 1);
+    short_row["t"] = Value(string(400, 's'));
+    short_table.update(short_handles[0], &short_row);
+    ValueDict *short_result = short_table.project(short_handles[0]);
+    bool short_ok = (*short_result)["t"] == short_row["t"];
+    delete short_result;
+    short_result = short_table.project(short_handles[1]);
+    short_ok = short_ok && (*short_result)["t"] == Value("");
+    delete short_result;
+    short_table.del(short_handles[1]);
+    short_table.del(short_handles[1]);  // already deleted, so nothing to do
+    try {
+        short_table.update(short_handles[1], &short_row);
+        short_ok = false;
+    } catch (DbRelationError &e) {
+        // can't update a deleted row
+    }
+    short_table.drop();
+    if (!short_ok)
+        return assertion_failure("short row not moved");
+    cout << "overflow ok" << endl;
+
+    HeapTable pax_table("_test_pax_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, true);
+    pax_table.create();
+    Handles pax_handles;
+    for (int i = 0; i < 1000; i++) {
+        test_set_row(row, i, i == 500 ? huge_b : b.substr(0, i % 100));
+        pax_handles.push_back(pax_table.insert(&row));
+    }
+    pax_table.close();
+    HeapTable pax_reopened("_test_pax_cpp", column_names, column_attributes);  // finds out from the blocks
+    handles = pax_reopened.select();
+    bool all_there = handles->size() == 1000;
+    delete handles;
+    if (!all_there)
+        return false;
+    for (i = 0; i < 1000; i++)
+        if (!test_compare(pax_reopened, pax_handles[i], i, i == 500 ? huge_b : b.substr(0, i % 100)))
+            return false;
+    result = pax_reopened.project(pax_handles[500], &just_a);
+    only_a = result->size() == 1 && result->at("a") == Value(500);
+    delete result;
+    if (!only_a)
+        return false;
+    pax_reopened.del(pax_handles[500]);
+    ValueDict where;
+    where["a"] = Value(999);
+    handles = pax_reopened.select(&where);
+    if (handles->size() != 1 || handles->at(0) != pax_handles[999])
+        return false;
+    delete handles;
+    pax_reopened.drop();
+    cout << "pax ok" << endl;
+
+    // a new table gets ROW_FORMAT_2; one whose block 1 doesn't say is from before, so ROW_FORMAT_1
+    for (u_int16_t format: {HeapTable::ROW_FORMAT_2, HeapTable::ROW_FORMAT_1}) {
+        HeapTable *formatted = new HeapTable("_test_row_format_cpp", column_names, column_attributes);
+        formatted->create();
+        if (format == HeapTable::ROW_FORMAT_1) {
+            formatted->close();
+            delete formatted;
+            HeapFile unformatted("_test_row_format_cpp");
+            unformatted.open();
+            SlottedPage *first = dynamic_cast<SlottedPage *>(unformatted.get(1));
+            first->set_row_format(0);
+            unformatted.put(first);
+            delete first;
+            unformatted.close();
+            formatted = new HeapTable("_test_row_format_cpp", column_names, column_attributes);
+        }
+        Handles format_handles;
+        for (i = 0; i < 100; i++) {
+            test_set_row(row, i, i == 50 ? huge_b : b.substr(0, i));
+            format_handles.push_back(formatted->insert(&row));
+        }
+        new_values.clear();
+        new_values["b"] = Value(huge_b);
+        formatted->update(format_handles[7], &new_values);  // out of line now
+        new_values["b"] = Value("short");
+        formatted->update(format_handles[50], &new_values);  // back in line
+        formatted->del(format_handles[99]);
+        formatted->close();
+        delete formatted;
+        formatted = new HeapTable("_test_row_format_cpp", column_names, column_attributes);
+        formatted->open();
+        if (formatted->get_row_format() != format)
+            return assertion_failure("wrong row format", formatted->get_row_format(), format);
+        handles = formatted->select();
+        bool format_ok = handles->size() == 99;
+        delete handles;
+        for (i = 0; i < 99 && format_ok; i++) {
+            string expected = i == 7 ? huge_b : i == 50 ? "short" : b.substr(0, i);
+            format_ok = test_compare(*formatted, format_handles[i], i, expected);
+        }
+        ColumnNames just_c(1, "c");
+        result = formatted->project(format_handles[42], &just_c);
+        format_ok = format_ok && result->size() == 1 && result->at("c").n == 1;
+        delete result;
+        where.clear();
+        where["b"] = Value(huge_b);
+        where["a"] = Value(7);
+        handles = formatted->select(&where);
+        format_ok = format_ok && handles->size() == 1 && handles->at(0) == format_handles[7];
+        delete handles;
+        formatted->drop();
+        delete formatted;
+        if (!format_ok)
+            return false;
+    }
+    cout << "row format ok" << endl;
+
+    HeapTable batch_table("_test_batch_cpp", column_names, column_attributes);
+    batch_table.create();
+    ValueDicts batch_rows;
+    for (int i = 0; i < 2000; i++) {
+        ValueDict *batch_row = new ValueDict();
+        test_set_row(*batch_row, i, b);
+        batch_rows.push_back(batch_row);
+    }
+    Handles *batch_handles = batch_table.insert_batch(&batch_rows);
+    for (auto const &batch_row: batch_rows)
+        delete batch_row;
+    handles = batch_table.select();
+    bool batch_ok = *handles == *batch_handles && handles->size() == 2000;
+    delete batch_handles;
+    i = 0;
+    for (auto const &handle: *handles)
+        if (!test_compare(batch_table, handle, i++, b))
+            batch_ok = false;
+    delete handles;
+    if (!batch_ok)
+        return false;
+    batch_table.drop();
+    cout << "insert_batch ok" << endl;
+
+    BufferPool &pool = BufferPool::shared();
+    size_t budget = pool.get_budget();
+    pool.set_budget(4 * DbBlock::BLOCK_SZ);  // much smaller than the table, so blocks get evicted
+    pool.reset_counters();
+    HeapTable pool_table("_test_pool_cpp", column_names, column_attributes);
+    pool_table.create();
+    for (i = 0; i < 1000; i++) {
+        test_set_row(row, i, b);
+        pool_table.insert(&row);
+    }
+    handles = pool_table.select();
+    bool pool_ok = handles->size() == 1000 && pool.get_hits() > 0 && pool.get_evictions() > 0
+                   && pool.get_used() <= pool.get_budget();
+    i = 0;
+    for (auto const &handle: *handles)
+        if (!test_compare(pool_table, handle, i++, b))
+            pool_ok = false;
+    delete handles;
+    pool_table.close();
+    pool_table.open();
+    handles = pool_table.select();
+    if (handles->size() != 1000 || !test_compare(pool_table, handles->at(999), 999, b))
+        pool_ok = false;
+    delete handles;
+    DbBlock *first = pool_table.file->get(1);
+    DbBlock *second = pool_table.file->get(1);  // a second pin on the same frame
+    u_int16_t size = second->size();
+    RecordIDs *ids = first->ids();
+    first->del(ids->front());
+    delete ids;
+    if (second->size() != size - 1)
+        pool_ok = false;
+    pool_table.file->put(first);
+    delete first;
+    delete second;
+    pool_table.drop();
+    pool.set_budget(budget);
+    if (!pool_ok)
+        return false;
+    cout << "buffer pool ok" << endl;
+
+    HeapTable tail_table("_test_tail_cpp", column_names, column_attributes);
+    tail_table.create();
+    pool.reset_counters();
+    for (i = 0; i < 20; i++) {
+        test_set_row(row, i, b.substr(0, 10));
+        tail_table.insert(&row);
+    }
+    bool tail_ok = pool.get_hits() + pool.get_misses() <= 1;  // the rest went right into the pinned tail block
+    tail_table.flush();
+    vector<char> on_disk(tail_table.file->get_block_size());
+    tail_table.file->read_page(1, on_disk.data(), (u_int32_t) on_disk.size());  // right from Berkeley DB
+    Dbt on_disk_block(on_disk.data(), (u_int32_t) on_disk.size());
+    RecordIDs *on_disk_ids = SlottedPage(on_disk_block, 1).ids();
+    if (on_disk_ids->size() != 20)
+        tail_ok = false;
+    delete on_disk_ids;
+    tail_table.flush();
+    handles = tail_table.select();
+    if (handles->size() != 20)
+        tail_ok = false;
+    i = 0;
+    for (auto const &handle: *handles)
+        if (!test_compare(tail_table, handle, i++, b.substr(0, 10)))
+            tail_ok = false;
+    tail_table.del(handles->at(5));  // works on the tail block through get()
+    delete handles;
+    test_set_row(row, 20, b.substr(0, 10));
+    Handle tail_handle = tail_table.insert(&row);
+    handles = tail_table.select();
+    if (handles->size() != 20 || !test_compare(tail_table, tail_handle, 20, b.substr(0, 10)))
+        tail_ok = false;
+    delete handles;
+    tail_table.drop();
+    if (!tail_ok)
+        return false;
+    cout << "tail page ok" << endl;
+
+    HeapTable mapped_table("_test_mapped_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, false,
+                           HeapTable::MAPPED);
+    mapped_table.create();
+    Handles mapped_handles;
+    for (i = 0; i < 5000; i++) {  // enough blocks to grow the file more than once
+        test_set_row(row, i, b);
+        mapped_handles.push_back(mapped_table.insert(&row));
+    }
+    mapped_table.del(mapped_handles[10]);
+    mapped_table.close();
+    HeapTable mapped_reopened("_test_mapped_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, false,
+                              HeapTable::MAPPED);
+    handles = mapped_reopened.select();
+    bool mapped_ok = handles->size() == 4999;
+    delete handles;
+    for (i = 0; i < 5000; i += 499)
+        if (i != 10 && !test_compare(mapped_reopened, mapped_handles[i], i, b))
+            mapped_ok = false;
+    Handles some_handles(mapped_handles.begin() + 4000, mapped_handles.end());
+    ValueDicts *some_rows = mapped_reopened.project(&some_handles, &just_a);  // prefetches their blocks
+    for (i = 0; i < (int) some_rows->size(); i++) {
+        if (some_rows->at(i)->at("a") != Value(4000 + i))
+            mapped_ok = false;
+        delete some_rows->at(i);
+    }
+    if (some_rows->size() != 1000)
+        mapped_ok = false;
+    delete some_rows;
+    mapped_reopened.drop();
+    if (!mapped_ok || MappedFile::exists("_test_mapped_cpp"))
+        return false;
+    cout << "mapped ok" << endl;
+
+    HeapFile extent_file("_test_extent_cpp");
+    extent_file.create();  // block 1
+    for (BlockID expected = 2; expected <= HeapFile::EXTENT_BLOCKS + 2; expected++) {
+        DbBlock *block = extent_file.get_new();
+        bool in_order = block->get_block_id() == expected;
+        if (expected == 3) {
+            char bytes[] = "not empty";
+            Dbt data(bytes, sizeof(bytes));
+            block->add(&data);
+            extent_file.put(block);
+        }
+        delete block;
+        if (!in_order)
+            return false;
+    }
+    extent_file.close();
+    extent_file.open();  // the empty blocks in the last extent get handed out again
+    bool extent_ok = extent_file.get_last_block_id() == HeapFile::EXTENT_BLOCKS;
+    DbBlock *new_block = extent_file.get_new();
+    if (new_block->get_block_id() != HeapFile::EXTENT_BLOCKS + 1 || new_block->size() != 0)
+        extent_ok = false;
+    delete new_block;
+    BlockIDRange all = extent_file.block_ids();
+    if (all.size() != HeapFile::EXTENT_BLOCKS + 1 || extent_file.block_ids(3, 100).size() != all.size() - 2)
+        extent_ok = false;
+    vector<BlockIDRange> parts = all.split(4);
+    BlockID next = 1;
+    for (auto const &part: parts) {
+        if (part.get_first() != next || part.size() < all.size() / 4)
+            extent_ok = false;
+        next = part.get_last() + 1;
+    }
+    if (parts.size() != 4 || next != all.get_last() + 1 || !BlockIDRange(5, 4).split(2).empty())
+        extent_ok = false;
+    extent_file.close();
+    HeapFile fresh_file("_test_extent_cpp");
+    fresh_file.open();  // a new HeapFile, with blocks left in the last extent to hand out
+    new_block = fresh_file.get_new();
+    char fresh_bytes[] = "fresh";
+    Dbt fresh_data(fresh_bytes, sizeof(fresh_bytes));
+    if (new_block->get_block_id() != HeapFile::EXTENT_BLOCKS + 1 || new_block->size() != 0
+        || new_block->add(&fresh_data) != 1)
+        extent_ok = false;
+    fresh_file.put(new_block);
+    delete new_block;
+    fresh_file.close();
+    extent_file.drop();
+    if (!extent_ok)
+        return false;
+    cout << "extents ok" << endl;
+
+    // append() keeps going past however many blocks the free space map is wrong about
+    HeapFile stale_file("_test_stale_fsm_cpp", DbBlock::BLOCK_SZ, nullptr, false, true);
+    stale_file.create();
+    vector<char> filler(1000, 'f');
+    vector<Dbt> fillers(16, Dbt(filler.data(), (u32) filler.size()));  // four to a block
+    Handles stale_handles;
+    stale_file.append(fillers.data(), (u32) fillers.size(), stale_handles);
+    DbBlock *roomy = stale_file.get(3);
+    roomy->del(1);
+    stale_file.put(roomy);
+    delete roomy;
+    stale_file.free_space->set(1, 2000);
+    stale_file.free_space->set(2, 2000);
+    stale_handles.clear();
+    stale_file.append(fillers.data(), 1, stale_handles);
+    bool stale_ok = stale_handles.size() == 1 && stale_handles[0].first == 3 && stale_file.get_last_block_id() == 4
+                    && stale_file.free_space->get(1) < 1004 && stale_file.free_space->get(2) < 1004;
+    stale_file.drop();
+    if (!stale_ok)
+        return assertion_failure("append gave up on the free space map", stale_handles.at(0).first);
+    cout << "stale free space map ok" << endl;
+
+    HeapFile scan_file("_test_scan_cpp");
+    scan_file.create();
+    char scan_bytes[] = "block 0";
+    Dbt scan_data(scan_bytes, sizeof(scan_bytes));
+    for (i = 1; i <= 20; i++) {
+        DbBlock *block = i == 1 ? scan_file.get(1) : scan_file.get_new();
+        scan_bytes[6] = (char) ('a' + i);
+        block->add(&scan_data);
+        scan_file.put(block);
+        delete block;
+    }
+    scan_file.close();
+    scan_file.open();
+    DbBlock *changed = scan_file.get(7);  // only in the buffer pool until the file is closed
+    changed->add(&scan_data);
+    scan_file.put(changed);
+    delete changed;
+    bool scan_ok = true;
+    for (u_int32_t read_ahead: {3U, 1U}) {
+        scan_file.set_read_ahead(read_ahead);
+        BlockScan *scan = scan_file.scan(scan_file.block_ids(5, 100));
+        BlockID expected = 5;
+        for (DbBlock *block = scan->next(); block != nullptr; block = scan->next(), expected++) {
+            Dbt *got = block->get(1);
+            if (block->get_block_id() != expected || ((char *) got->get_data())[6] != (char) ('a' + expected)
+                || block->size() != (expected == 7 ? 2 : 1))
+                scan_ok = false;
+            delete got;
+            delete block;
+        }
+        delete scan;
+        if (expected != 21)
+            scan_ok = false;
+    }
+    scan_file.drop();
+    if (!scan_ok)
+        return false;
+    cout << "scan ok" << endl;
+
+    HeapTable direct_table("_test_direct_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, false,
+                           HeapTable::DIRECT);
+    direct_table.create();
+    Handles direct_handles;
+    for (i = 0; i < 3000; i++) {
+        test_set_row(row, i, b);
+        direct_handles.push_back(direct_table.insert(&row));
+    }
+    direct_table.close();
+    HeapTable direct_reopened("_test_direct_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, false,
+                              HeapTable::DIRECT);
+    handles = direct_reopened.select();
+    bool direct_ok = handles->size() == 3000;
+    delete handles;
+    for (i = 0; i < 3000; i += 7)
+        if (!test_compare(direct_reopened, direct_handles[i], i, b))
+            direct_ok = false;
+    direct_reopened.drop();
+    if (!direct_ok || DirectFile::exists("_test_direct_cpp"))
+        return false;
+    cout << "direct ok" << endl;
+
+    string text;
+    for (i = 0; text.size() < DbBlock::BLOCK_SZ; i++)
+        text += "row " + to_string(i % 50) + " of the archive, mostly the same as the others; ";
+    text.resize(DbBlock::BLOCK_SZ);
+    vector<char> packed(DbBlock::BLOCK_SZ), unpacked(DbBlock::BLOCK_SZ);
+    u_int32_t packed_size = BlockCodec::lz().compress(text.data(), DbBlock::BLOCK_SZ, packed.data(),
+                                                      DbBlock::BLOCK_SZ);
+    bool compressed_ok = packed_size > 0 && packed_size < DbBlock::BLOCK_SZ / 4;
+    if (compressed_ok) {
+        BlockCodec::find(LzCodec::ID)->decompress(packed.data(), packed_size, unpacked.data(), DbBlock::BLOCK_SZ);
+        compressed_ok = memcmp(unpacked.data(), text.data(), DbBlock::BLOCK_SZ) == 0;
+    }
+    for (auto &c: text)
+        c = (char) rand();
+    if (BlockCodec::lz().compress(text.data(), DbBlock::BLOCK_SZ, packed.data(), DbBlock::BLOCK_SZ - 1) != 0)
+        compressed_ok = false;  // random bytes don't compress
+    HeapTable compressed_table("_test_compressed_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ, false,
+                               HeapTable::COMPRESSED);
+    compressed_table.create();
+    Handles compressed_handles;
+    for (i = 0; i < 3000; i++) {
+        test_set_row(row, i, b);
+        compressed_handles.push_back(compressed_table.insert(&row));
+    }
+    compressed_table.del(compressed_handles[10]);
+    compressed_table.close();
+    HeapTable compressed_reopened("_test_compressed_cpp", column_names, column_attributes, DbBlock::BLOCK_SZ,
+                                  false, HeapTable::COMPRESSED);
+    handles = compressed_reopened.select();  // decompresses in bulk
+    if (handles->size() != 2999)
+        compressed_ok = false;
+    delete handles;
+    for (i = 0; i < 3000; i += 7)
+        if (i != 10 && !test_compare(compressed_reopened, compressed_handles[i], i, b))
+            compressed_ok = false;
+    compressed_reopened.drop();
+    if (!compressed_ok || CompressedFile::exists("_test_compressed_cpp"))
+        return false;
+    cout << "compressed ok" << endl;
+
+    Tablespace tablespace({"", "", ""});  // three stripes, though all in the home directory
+    StripedFile striped_file("_test_striped_cpp", tablespace);
+    striped_file.create();
+    for (i = 1; i <= 20; i++) {
+        DbBlock *block = i == 1 ? striped_file.get(1) : striped_file.get_new();
+        scan_bytes[6] = (char) ('a' + i);
+        block->add(&scan_data);
+        striped_file.put(block);
+        delete block;
+    }
+    striped_file.close();
+    Tablespace one_stripe({""});
+    StripedFile striped_again("_test_striped_cpp", one_stripe);
+    bool created_again = true;
+    try {
+        striped_again.create();  // already there, so its layout must be left alone
+    } catch (DbException &e) {
+        created_again = false;
+    }
+    if (created_again)
+        return assertion_failure("striped file created over an existing one");
+    StripedFile striped_reopened("_test_striped_cpp");  // finds its stripes, whatever the tablespace says
+    striped_reopened.open();
+    bool striped_ok = striped_reopened.get_stripe_count() == 3 && striped_reopened.get_last_block_id() == 20;
+    for (u_int32_t read_ahead: {7U, 1U}) {
+        striped_reopened.set_read_ahead(read_ahead);
+        BlockScan *scan = striped_reopened.scan(striped_reopened.block_ids(2, 100));
+        BlockID expected = 2;
+        for (DbBlock *block = scan->next(); block != nullptr; block = scan->next(), expected++) {
+            Dbt *got = block->get(1);
+            if (block->get_block_id() != expected || ((char *) got->get_data())[6] != (char) ('a' + expected))
+                striped_ok = false;
+            delete got;
+            delete block;
+        }
+        delete scan;
+        if (expected != 21)
+            striped_ok = false;
+    }
+    striped_reopened.drop();
+    if (!striped_ok || StripedFile::exists("_test_striped_cpp"))
+        return false;
+    cout << "striped ok" << endl;
+
+    table.drop();
     return true;
 }
@@ -9,17 +9,72 @@
 
 #include "storage_engine.h"
 #include "SlottedPage.h"
+#include "PaxPage.h"
 #include "HeapFile.h"
+#include "MappedFile.h"
+#include "DirectFile.h"
+#include "CompressedFile.h"
+#include "StripedFile.h"
 
 /**
  * @class HeapTable - Heap storage engine (implementation of DbRelation)
+ *
+ * TEXT values longer than an eighth of a block are kept out of line (like PostgreSQL's TOAST) in a
+ * side HeapFile, <table_name>.overflow, as a chain of chunk records:
+ *     [next chunk BlockID][next chunk RecordID][bytes...]   (a next BlockID of 0 ends the chain)
+ * In the row itself such a value's length prefix is OVERFLOW_MARKER, followed by the value's total
+ * length (4 bytes) and the BlockID and RecordID of its first chunk. The side file is only created once
+ * it is needed, and a value is only fetched from it when its column is projected.
+ *
+ * The side file also takes rows that update() makes too big for their home block. The row's slot in
+ * its home block becomes a forwarding stub to the row's new spot, so its Handle (and any index entries
+ * for it) stay good, and scans, which never look at the side file, still see it exactly once. A row
+ * that has to move again just gets its stub updated, so it is never more than one hop from home.
+ *
+ * Inserts go wherever the table file's FreeSpaceMap says there is room, so space freed by deletes is
+ * used again.
+ *
+ * A table can be created with its rows stored column-grouped (PaxPage) instead of row by row
+ * (SlottedPage); projecting a few columns from such a table only decodes those columns' minipages.
+ *
+ * A table can also be kept in a MappedFile, read through mmap rather than Berkeley DB, in a DirectFile,
+ * read with O_DIRECT so that the BufferPool is its only cache, or in a CompressedFile, whose blocks are
+ * compressed on disk, or in a StripedFile spread over the directories of Tablespace::shared() (whichever
+ * it is, its side file is still a Berkeley DB HeapFile). The kind of file isn't in the catalog, so it is up
+ * to whoever makes the HeapTable to say which it is every time; tables made through SQL (schema_tables)
+ * are always Berkeley DB ones, and the others are only for code that uses HeapTable directly.
+ *
+ * Rows are marshaled in one of two formats, kept track of per table:
+ *     ROW_FORMAT_1: every column in table order, each TEXT one as [u16 length][bytes...] (or the overflow
+ *                   pointer above), so getting to a column means walking over the lengths of those before it
+ *     ROW_FORMAT_2: [u16 offset of each TEXT column][fixed-width columns in table order][TEXT columns in table
+ *                   order], each column's bits the same as in ROW_FORMAT_1. A fixed-width column is at the same
+ *                   spot in every row and a TEXT one is where its offset says, so any column is one jump away.
+ * Tables created as SlottedPage tables get ROW_FORMAT_2, stamped on block 1 of the table's file (see
+ * HeapFile::set_row_format()), so the format can't be lost or left behind apart from the rows. Tables whose
+ * block 1 says nothing (PaxPage ones, which already keep each column apart, and ones from before there was a
+ * second format) are ROW_FORMAT_1 and stay that way.
  */
 
+class RowMatcher;
+
 class HeapTable : public DbRelation {
 public:
-    HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes);
+    /**
+     * Which kind of file a table's blocks are kept in.
+     */
+    enum Storage {
+        BERKELEY_DB,  // HeapFile
+        MAPPED,       // MappedFile
+        DIRECT,       // DirectFile
+        COMPRESSED,   // CompressedFile
+        STRIPED       // StripedFile
+    };
+
+    HeapTable(Identifier table_name, ColumnNames column_names, ColumnAttributes column_attributes,
+              u_int32_t block_size = DbBlock::BLOCK_SZ, bool pax = false, Storage storage = BERKELEY_DB);
 
-    virtual ~HeapTable() {}
+    virtual ~HeapTable();
 
     HeapTable(const HeapTable &other) = delete;
 
@@ -39,8 +94,12 @@ public:
 
     virtual void close();
 
+    virtual void flush();
+
     virtual Handle insert(const ValueDict *row);
 
+    virtual Handles *insert_batch(const ValueDicts *rows);
+
     virtual void update(const Handle handle, const ValueDict *new_values);
 
     virtual void del(const Handle handle);
@@ -51,24 +110,149 @@ public:
 
     virtual Handles* select(Handles *current_selection, const ValueDict* where);
 
+    virtual SelectCursor *select_cursor(const ValueDict *where);
+
+    using DbRelation::select_cursor;
+
     virtual ValueDict *project(Handle handle);
 
     virtual ValueDict *project(Handle handle, const ColumnNames *column_names);
 
+    virtual ValueDicts *project(Handles *handles);
+
+    virtual ValueDicts *project(Handles *handles, const ColumnNames *column_names);
+
     using DbRelation::project;
 
+    virtual Row *project_row(Handle handle, const ColumnOrdinals &columns);
+
+    virtual void prefetch(const Handles *handles);
+
+    /**
+     * The format the table's rows are marshaled in (known once the table has been opened or created).
+     * @return ROW_FORMAT_1 or ROW_FORMAT_2
+     */
+    virtual u_int16_t get_row_format() const { return row_format; }
+
+    static const u_int16_t ROW_FORMAT_1 = 1;  // columns in table order, each TEXT one length-prefixed
+    static const u_int16_t ROW_FORMAT_2 = 2;  // TEXT offsets, then fixed-width columns, then TEXT columns
+
 protected:
-    HeapFile file;
+    static const uint OVERFLOW_CHUNK_HEADER_SZ = sizeof(BlockID) + sizeof(RecordID);
+    static const uint OVERFLOW_SLACK = 32;  // room left in a chunk's block for the block and record headers
+
+    HeapFile *file;
+    HeapFile overflow;
+    u_int16_t row_format;
+    std::vector<u_int16_t> locations;  // ROW_FORMAT_2: where each column is, or where its offset is for a TEXT one
+
+    virtual void set_row_format(u_int16_t row_format);
 
     virtual ValueDict *validate(const ValueDict *row) const;
 
     virtual Handle append(const ValueDict *row);
 
-    virtual Dbt *marshal(const ValueDict *row) const;
+    virtual Dbt *marshal(const ValueDict *row);
+
+    virtual uint marshal_value(ColumnAttribute::DataType data_type, const Value &value, char *bytes, uint offset);
+
+    virtual Row *unmarshal(const DbBlock *block, RecordID record_id, const ColumnOrdinals &columns);
+
+    virtual void unmarshal_value(ColumnAttribute::DataType data_type, const char *bytes, Value &value);
+
+    virtual const char *field(const char *bytes, uint column) const;
+
+    static uint field_size(ColumnAttribute::DataType data_type, const char *bytes);
+
+    virtual void open_overflow();
+
+    virtual void put_overflow(const std::string &value, char *pointer);
+
+    virtual std::string get_overflow(const char *pointer);
+
+    virtual void del_overflow(RecordView data);
+
+    virtual void del_overflow_chunks(BlockID block_id, RecordID record_id);
 
-    virtual ValueDict *unmarshal(Dbt *data) const;
+    virtual Row *project_row(const DbBlock *block, RecordID record_id, const ColumnOrdinals &columns);
 
-    virtual bool selected(Handle handle, const ValueDict *where);
+    virtual bool selected(const DbBlock *block, RecordID record_id, const RowMatcher &matcher);
+
+    virtual DbBlock *locate(Handle handle, RecordID &record_id);
+
+    virtual Handle move_out(const Dbt &data);
+
+    friend class RowMatcher;
+    friend class HeapTableCursor;
+    friend bool test_heap_storage();
+};
+
+/**
+ * @class RowMatcher - a where conjunction compiled once for a HeapTable's columns, to check rows right on their
+ * marshaled bytes instead of unmarshaling them
+ *
+ * Each test knows its column's position and type, so checking a record is a jump straight to the field (in a
+ * PaxPage or a ROW_FORMAT_2 row) or a walk over the lengths of the columns before it, and then a 4-byte
+ * compare for an INT, a 1-byte compare for a BOOLEAN, or a length check and memcmp for a TEXT. An out-of-line
+ * TEXT value is only fetched when its length matches. Columns after the last one tested are never looked at.
+ */
+class RowMatcher {
+public:
+    RowMatcher(HeapTable &table, const ValueDict *where);
+
+    virtual ~RowMatcher() {}
+
+    virtual bool matches(const DbBlock *block, RecordID record_id) const;
+
+    /**
+     * Check if there is nothing to test, so every row matches.
+     * @return true if the where clause was nullptr or empty
+     */
+    virtual bool matches_everything() const { return tests.empty(); }
+
+protected:
+    struct Test {
+        uint column;
+        ColumnAttribute::DataType data_type;
+        int32_t n;      // value for an INT or BOOLEAN
+        std::string s;  // value for a TEXT
+    };
+
+    HeapTable &table;
+    std::vector<ColumnAttribute::DataType> data_types;  // of the columns up to the last one tested (ROW_FORMAT_1)
+    std::vector<Test> tests;                            // in column order
+    bool never;  // some value is of the wrong type for its column, so no row matches
+
+    virtual bool passes(const Test &test, const char *bytes) const;
+};
+
+/**
+ * @class HeapTableCursor - SelectCursor that scans a HeapTable's file a block at a time, so only the block it
+ * is on is in memory and the first rows come back before the rest of the table has been read
+ *
+ * Filtering and project_row() both work on the block the scan already has, so each block is gotten once no
+ * matter how many of its rows are selected.
+ */
+class HeapTableCursor : public SelectCursor {
+public:
+    HeapTableCursor(HeapTable &table, const ValueDict *where);
+
+    virtual ~HeapTableCursor();
+
+    HeapTableCursor(const HeapTableCursor &other) = delete;
+
+    HeapTableCursor &operator=(const HeapTableCursor &other) = delete;
+
+    virtual bool next(Handle &handle);
+
+    virtual Row *project_row(const ColumnOrdinals &columns);
+
+protected:
+    HeapTable &table;
+    RowMatcher matcher;
+    BlockScan *scan;     // nullptr once it is done
+    DbBlock *block;      // block being looked at (or nullptr)
+    RecordID record_id;  // last record looked at in it
 };
 
 bool test_heap_storage();
@@ -0,0 +1,264 @@
+/**
+ * @file MappedFile.cpp
+ * @see Seattle University, CPSC5300
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MappedFile.h"
+
+using namespace std;
+typedef uint32_t u32;
+
+/**
+ * Constructor
+ * @param name
+ * @param block_size         size of the blocks if the file gets created
+ * @param column_attributes  layout of the records, needed to read PaxPage blocks (kept by the caller)
+ * @param pax                true to use PaxPage blocks if the file gets created
+ * @param free_space_map     true to keep a FreeSpaceMap for append() to use
+ */
+MappedFile::MappedFile(string name, u32 block_size, const ColumnAttributes *column_attributes, bool pax,
+                       bool free_space_map)
+        : HeapFile(name, block_size, column_attributes, pax, free_space_map), fd(-1), base(nullptr),
+          mapped_size(0) {
+    this->dbfilename = path(name);
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+/**
+ * Delete the physical file.
+ */
+void MappedFile::drop(void) {
+    close();
+    if (::unlink(this->dbfilename.c_str()) != 0)
+        fail("unlink");
+    if (this->free_space != nullptr)
+        this->free_space->drop();
+}
+
+/**
+ * Sync the file to disk and close it.
+ */
+void MappedFile::close(void) {
+    if (this->closed)
+        return;
+    release_tail();
+    ::msync(this->base, this->mapped_size, MS_SYNC);
+    ::munmap(this->base, MAX_FILE_SZ);
+    ::close(this->fd);
+    this->base = nullptr;
+    this->mapped_size = 0;
+    this->fd = -1;
+    if (this->free_space != nullptr)
+        this->free_space->close();
+    this->closed = true;
+}
+
+/**
+ * Sync the file to disk.
+ */
+void MappedFile::sync(void) {
+    ::msync(this->base, this->mapped_size, MS_SYNC);
+}
+
+/**
+ * Allocate a new block for the file.
+ * @return the new empty DbBlock (freed by caller)
+ */
+DbBlock *MappedFile::get_new(void) {
+    BlockID block_id = this->last + 1;
+    reserve(block_id);
+    this->last = header()->last = block_id;
+    Dbt data(address(block_id), this->block_size);
+    DbBlock *page = make_block(data, block_id, true);
+    if (this->free_space != nullptr)
+        this->free_space->set(block_id, page->unused_bytes());
+    return page;
+}
+
+/**
+ * Get a block from the file. The DbBlock is right on the mapped memory.
+ * @param block_id
+ * @return          the given block (freed by caller)
+ */
+DbBlock *MappedFile::get(BlockID block_id) {
+    forget_tail(block_id);
+    if (block_id == 0 || block_id > this->last)
+        throw DbRelationError(this->name + " has no block " + to_string(block_id));
+    Dbt data(address(block_id), this->block_size);
+    return make_block(data, block_id, false);
+}
+
+/**
+ * Write a block back to the file. Blocks from get() or get_new() are already there; any other block
+ * (with a block id up to one past the last) is copied in.
+ * @param block
+ */
+void MappedFile::put(DbBlock *block) {
+    BlockID block_id = block->get_block_id();
+    if (block_id > this->last + 1)
+        throw DbRelationError(this->name + " has no block " + to_string(block_id));
+    reserve(block_id);
+    char *to = address(block_id);
+    if (block->get_block()->get_data() != to)
+        memcpy(to, block->get_block()->get_data(), this->block_size);
+    if (block_id > this->last)
+        this->last = block_id;
+    header()->last = this->last;
+    if (this->free_space != nullptr)
+        this->free_space->set(block_id, block->unused_bytes());
+}
+
+/**
+ * Read a run of blocks in order, prefetching get_read_ahead() blocks ahead of the one being read.
+ * @param range  blocks to read (any past the last block are skipped)
+ * @return       the scan (freed by caller, before the file is closed)
+ */
+BlockScan *MappedFile::scan(BlockIDRange range) {
+    return new BlockScan(*this, range.subrange(1, this->last), this->read_ahead > 1 ? this->read_ahead : 0);
+}
+
+/**
+ * Start the kernel reading in a run of blocks.
+ * @param range  the blocks (any past the last block are skipped)
+ */
+void MappedFile::prefetch(BlockIDRange range) {
+    range = range.subrange(1, this->last);
+    if (this->closed || range.empty())
+        return;
+    ::madvise(address(range.get_first()), (size_t) range.size() * this->block_size, MADV_WILLNEED);
+}
+
+/**
+ * Start the kernel reading in some blocks, a run of neighboring blocks at a time.
+ * @param block_ids  the blocks, in any order
+ */
+void MappedFile::prefetch(const BlockIDs &block_ids) {
+    BlockIDs sorted(block_ids);
+    sort(sorted.begin(), sorted.end());
+    for (size_t i = 0; i < sorted.size();) {
+        size_t j = i + 1;
+        while (j < sorted.size() && sorted[j] <= sorted[j - 1] + 1)
+            j++;
+        prefetch(BlockIDRange(sorted[i], sorted[j - 1]));
+        i = j;
+    }
+}
+
+/**
+ * Check if a table has a MappedFile.
+ * @param name  the file's name
+ * @return      true if <name>.pages is there
+ */
+bool MappedFile::exists(string name) {
+    struct stat st;
+    return ::stat(path(name).c_str(), &st) == 0;
+}
+
+/**
+ * Open the file (and create it, depending on the flags) and map it.
+ * @param flags  Berkeley DB flags: DB_CREATE and DB_EXCL mean the same as O_CREAT and O_EXCL
+ */
+void MappedFile::db_open(uint flags) {
+    if (!this->closed)
+        return;
+    int open_flags = O_RDWR;
+    if (flags & DB_CREATE)
+        open_flags |= O_CREAT;
+    if (flags & DB_EXCL)
+        open_flags |= O_EXCL;
+    this->fd = ::open(this->dbfilename.c_str(), open_flags, 0644);
+    if (this->fd < 0)
+        fail("open");
+    void *reserved = ::mmap(nullptr, MAX_FILE_SZ, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED) {
+        ::close(this->fd);
+        fail("mmap");
+    }
+    this->base = (char *) reserved;
+    this->mapped_size = 0;
+
+    try {
+        struct stat st;
+        ::fstat(this->fd, &st);
+        if (st.st_size == 0) {
+            reserve(0);
+            header()->magic = MAGIC;
+            header()->block_size = this->block_size;
+            header()->last = 0;
+        } else {
+            if (::mmap(this->base, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, this->fd, 0)
+                == MAP_FAILED)
+                fail("mmap");
+            this->mapped_size = st.st_size;
+            if (header()->magic != MAGIC)
+                throw DbRelationError(this->dbfilename + " is not a MappedFile");
+            this->block_size = header()->block_size;  // an existing file keeps the block size it was created with
+        }
+        this->last = get_block_count();
+        Dbt data(address(1), this->block_size);
+        opened(this->last > 0 ? &data : nullptr);
+    } catch (...) {
+        ::munmap(this->base, MAX_FILE_SZ);
+        ::close(this->fd);
+        this->base = nullptr;
+        this->mapped_size = 0;
+        this->fd = -1;
+        throw;
+    }
+}
+
+/**
+ * Number of blocks in use, as kept in the file's header.
+ * @return number of blocks
+ */
+uint32_t MappedFile::get_block_count() {
+    return header()->last;
+}
+
+/**
+ * Make sure the file is big enough for a block, growing it a whole extent at a time.
+ * @param block_id  the block
+ */
+void MappedFile::reserve(BlockID block_id) {
+    size_t needed = ((size_t) block_id + 1) * this->block_size;
+    if (needed <= this->mapped_size)
+        return;
+    size_t extent = (size_t) EXTENT_BLOCKS * this->block_size;
+    size_t new_size = (needed + extent - 1) / extent * extent;
+    if (new_size > MAX_FILE_SZ)
+        throw DbRelationError(this->name + " is as big as a MappedFile can get");
+    if (::ftruncate(this->fd, new_size) != 0)
+        fail("ftruncate");
+    if (::mmap(this->base + this->mapped_size, new_size - this->mapped_size, PROT_READ | PROT_WRITE,
+               MAP_SHARED | MAP_FIXED, this->fd, this->mapped_size) == MAP_FAILED)
+        fail("mmap");
+    this->mapped_size = new_size;
+}
+
+/**
+ * Where a table's MappedFile is: in the database environment's home directory, like the Berkeley DB files.
+ * @param name  the file's name
+ * @return      the path
+ */
+string MappedFile::path(string name) {
+    return env_path(name + ".pages");
+}
+
+/**
+ * Report a failed system call the way Berkeley DB would.
+ * @param what  the call
+ * @throws DbException
+ */
+void MappedFile::fail(string what) {
+    int error = errno;
+    throw DbException((this->dbfilename + ": " + what + ": " + strerror(error)).c_str(), error);
+}
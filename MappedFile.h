@@ -0,0 +1,95 @@
+/**
+ * @file MappedFile.h - HeapFile kept in one flat file and read through mmap.
+ * MappedFile: HeapFile
+ *
+ * @see "Seattle University, CPSC5300, Spring 2022"
+ */
+#pragma once
+
+#include "HeapFile.h"
+
+/**
+ * @class MappedFile - heap file whose blocks are in a plain file, <name>.pages, mapped into memory
+ *
+ * Block n is at offset n * block_size, so get() is just pointer arithmetic: no Berkeley DB lookup, no
+ * copy, and no BufferPool frame (the operating system's page cache is the buffer pool). The DbBlock
+ * works right on the mapped memory, so its changes are in the file as soon as they are made; put() only
+ * has to copy blocks that were built somewhere else (like the new blocks from append()). The file is
+ * synced to disk when it is closed.
+ *
+ * prefetch() has the kernel start reading blocks in (madvise MADV_WILLNEED) without waiting for them, so
+ * scans and fetches of lists of rows have lots of reads going at once instead of faulting in one block
+ * at a time.
+ *
+ * Block 0 is the file's header: a magic number, the block size and the number of blocks in use. The file
+ * grows EXTENT_BLOCKS blocks at a time. A run of address space big enough for MAX_FILE_SZ bytes is set
+ * aside when the file is opened, and the file is mapped into the start of it as it grows, so the blocks
+ * never move while they are being used.
+ *
+ * Everything else (SlottedPage or PaxPage blocks, the FreeSpaceMap, append()) works just as in HeapFile.
+ */
+class MappedFile : public HeapFile {
+public:
+    MappedFile(std::string name, u_int32_t block_size = DbBlock::BLOCK_SZ,
+               const ColumnAttributes *column_attributes = nullptr, bool pax = false, bool free_space_map = false);
+
+    virtual ~MappedFile();
+
+    MappedFile(const MappedFile &other) = delete;
+
+    MappedFile(MappedFile &&temp) = delete;
+
+    MappedFile &operator=(const MappedFile &other) = delete;
+
+    MappedFile &operator=(MappedFile &&temp) = delete;
+
+    virtual void drop(void);
+
+    virtual void close(void);
+
+    virtual DbBlock *get_new(void);
+
+    virtual DbBlock *get(BlockID block_id);
+
+    virtual void put(DbBlock *block);
+
+    virtual BlockScan *scan(BlockIDRange range);
+
+    virtual void prefetch(BlockIDRange range);
+
+    virtual void prefetch(const BlockIDs &block_ids);
+
+    static bool exists(std::string name);
+
+    static const u_int32_t EXTENT_BLOCKS = 64;
+    static const size_t MAX_FILE_SZ = (size_t) 1 << 34;
+
+protected:
+    static const u_int32_t MAGIC = 0x50414D46;  // "FMAP"
+
+    struct Header {
+        u_int32_t magic;
+        u_int32_t block_size;
+        u_int32_t last;
+    };
+
+    int fd;
+    char *base;         // start of the address space set aside for the file
+    size_t mapped_size;  // how much of the file is mapped (always all of it)
+
+    virtual void db_open(uint flags = 0);
+
+    virtual uint32_t get_block_count();
+
+    virtual void reserve(BlockID block_id);
+
+    virtual void sync(void);
+
+    virtual char *address(BlockID block_id) const { return this->base + (size_t) block_id * this->block_size; }
+
+    virtual Header *header() const { return (Header *) this->base; }
+
+    static std::string path(std::string name);
+
+    virtual void fail(std::string what);
+};
@@ -0,0 +1,665 @@
+/**
+ * @file PaxPage.cpp
+ * @author K Lundeen
+ * @see Seattle University, CPSC5300
+ */
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include "PaxPage.h"
+#include "SlottedPage.h"  // for assertion_failure()
+
+using namespace std;
+typedef uint16_t u16;
+typedef uint32_t u32;
+
+/**
+ * Round an offset up to the next 4-byte boundary.
+ */
+static u32 align4(u32 offset) {
+    return (offset + 3U) & ~3U;
+}
+
+/**
+ * PaxLayout constructor
+ * Sizes the minipages so that a block of records with average-length TEXT values fills the block evenly.
+ * @param column_attributes  the table's columns, in the order they are marshaled
+ * @param block_size         size of the blocks in the file
+ */
+PaxLayout::PaxLayout(const ColumnAttributes &column_attributes, u32 block_size) {
+    u32 per_record = 1;  // presence byte
+    for (ColumnAttribute ca: column_attributes) {
+        ColumnAttribute::DataType data_type = ca.get_data_type();
+        u32 width;
+        switch (data_type) {
+            case ColumnAttribute::INT:
+                width = sizeof(int32_t);
+                break;
+            case ColumnAttribute::BOOLEAN:
+                width = sizeof(u_int8_t);
+                break;
+            case ColumnAttribute::TEXT:
+                width = 2 * sizeof(u16);
+                per_record += TEXT_ESTIMATE;
+                break;
+            default:
+                throw DbRelationError("Only know how to lay out INT, TEXT, and BOOLEAN");
+        }
+        this->data_types.push_back(data_type);
+        this->widths.push_back(width);
+        per_record += width;
+    }
+    u32 slack = 4U * ((u32) this->data_types.size() + 1U);  // lost to lining the minipages up
+    u32 capacity = (block_size - PaxPage::HEADER_SZ - slack) / per_record;
+    this->capacity = (u16) min(capacity, (u32) PaxPage::PAX_MAGIC - 1U);
+
+    this->presence_offset = align4(PaxPage::HEADER_SZ);
+    u32 offset = align4(this->presence_offset + this->capacity);
+    for (u32 width: this->widths) {
+        this->offsets.push_back(offset);
+        offset = align4(offset + this->capacity * width);
+    }
+    this->heap_start = offset;
+}
+
+/**
+ * PaxPage constructor
+ * @param block
+ * @param block_id
+ * @param layout    where the minipages go (shared by every block in the file)
+ * @param is_new
+ */
+PaxPage::PaxPage(Dbt &block, BlockID block_id, const PaxLayout &layout, bool is_new)
+        : DbBlock(block, block_id, is_new), layout(layout), num_records(address(4)), num_live(address(6)),
+          end_free(address(8)), fragmented(address(10)), record() {
+    if (is_new) {
+        this->num_records = 0;
+        this->num_live = 0;
+        this->end_free = (u16) (get_block_size() - 1);
+        this->fragmented = 0;
+        memset(this->address(layout.get_presence_offset()), 0, layout.get_capacity());
+        put_header();
+    } else if (get_n(0) != PAX_MAGIC || get_n(2) != layout.get_capacity()) {
+        throw DbRelationError("block " + to_string(block_id) + " is not laid out for this table");
+    }
+}
+
+/**
+ * Add a new record to the block.
+ * The record id of a deleted record is handed out again if there is one, otherwise a new one is made.
+ * @param data  a row marshaled by HeapTable
+ * @return the new record's id
+ */
+RecordID PaxPage::add(const Dbt *data) {
+    vector<u32> sizes;
+    field_sizes(*data, sizes);
+    u32 needed = 0;
+    for (uint column = 0; column < this->layout.get_column_count(); column++)
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT)
+            needed += sizes[column];
+    if (this->num_live == this->layout.get_capacity() || needed > unused_bytes())
+        throw DbBlockNoRoomError("not enough room for new record");
+    if (needed > contiguous_bytes())
+        compact();  // the room is there, but only after reclaiming the fragmented bytes
+
+    RecordID id;
+    const char *presence = (const char *) this->address(this->layout.get_presence_offset());
+    if (this->num_live < this->num_records)
+        id = (RecordID) ((const char *) memchr(presence, 0, this->num_records) - presence + 1);
+    else
+        id = ++this->num_records;
+    this->num_live++;
+
+    const char *bytes = (const char *) data->get_data();
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+            u16 loc = store_text(bytes, (u16) sizes[column]);
+            put_text(id, column, (u16) sizes[column], loc);
+        } else {
+            u32 width = this->layout.get_width(column);
+            memcpy(this->address(this->layout.get_offset(column) + (id - 1U) * width), bytes, width);
+        }
+        bytes += sizes[column];
+    }
+    put_presence(id, 1);
+    return id;
+}
+
+/**
+ * Get a record from the block, put back together in the marshaled row format.
+ * @param record_id
+ * @return the bits of the record, or nullptr if it has been deleted (freed by caller, but the bits
+ *         themselves belong to the block and are only good until the next get() or view())
+ */
+Dbt *PaxPage::get(RecordID record_id) const {
+    RecordView data = view(record_id);
+    if (data.is_null())
+        return nullptr;
+    return new Dbt((void *) data.get_data(), data.get_size());
+}
+
+/**
+ * Look at a record in the block, put back together in the marshaled row format.
+ * Unlike SlottedPage, this has to copy the columns into a buffer kept by the block, so the view is only
+ * good until the next get() or view(). Use view_field() to avoid the copying.
+ * @param record_id
+ * @return view of the bits of the record, or a null view if it has been deleted
+ */
+RecordView PaxPage::view(RecordID record_id) const {
+    if (!is_live(record_id))
+        return RecordView();
+    if (get_presence(record_id) == FORWARDED)
+        return view_field(record_id, (uint) first_text_column());  // just the stub
+    u32 total = 0;
+    for (uint column = 0; column < this->layout.get_column_count(); column++)
+        total += view_field(record_id, column).get_size();
+    this->record.resize(total);
+    char *bytes = this->record.data();
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        RecordView field = view_field(record_id, column);
+        memcpy(bytes, field.get_data(), field.get_size());
+        bytes += field.get_size();
+    }
+    return RecordView(this->record.data(), total);
+}
+
+/**
+ * Look at one column's marshaled value for a record without putting the whole record back together.
+ * @param record_id  which record
+ * @param column     which column (by position)
+ * @return           view into the block's memory (is_null() if the record has been deleted)
+ */
+RecordView PaxPage::view_field(RecordID record_id, uint column) const {
+    if (!is_live(record_id))
+        return RecordView();
+    if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+        u16 size, loc;
+        get_text(record_id, column, size, loc);
+        return RecordView(this->address(loc), size);
+    }
+    u32 width = this->layout.get_width(column);
+    return RecordView(this->address(this->layout.get_offset(column) + (record_id - 1U) * width), width);
+}
+
+/**
+ * Replace the record (or forwarding stub) with the given data.
+ * Fixed-width values are simply overwritten. A TEXT value that got no bigger is rewritten in place;
+ * a bigger one goes to the free space and its old spot is released.
+ * @param record_id   record to replace
+ * @param data        new contents of record_id (a row marshaled by HeapTable)
+ * @throws DbBlockNoRoomError if it won't fit
+ */
+void PaxPage::put(RecordID record_id, const Dbt &data) {
+    vector<u32> sizes;
+    field_sizes(data, sizes);
+    u32 extra = 0;
+    u16 size, loc;
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+            get_text(record_id, column, size, loc);
+            if (sizes[column] > size)
+                extra += sizes[column] - size;
+        }
+    }
+    if (extra > contiguous_bytes() + this->fragmented)
+        throw DbBlockNoRoomError("not enough room for enlarged record");
+
+    // first give back the spots that are too small, so compaction can use them
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+            get_text(record_id, column, size, loc);
+            if (sizes[column] > size) {
+                put_text(record_id, column, 0, 0);
+                release(loc, size);
+            }
+        }
+    }
+    const char *bytes = (const char *) data.get_data();
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+            u16 new_size = (u16) sizes[column];
+            get_text(record_id, column, size, loc);
+            if (loc != 0) {
+                memcpy(this->address(loc), bytes, new_size);
+                this->fragmented += size - new_size;
+            } else {
+                loc = store_text(bytes, new_size);
+            }
+            put_text(record_id, column, new_size, loc);
+        } else {
+            u32 width = this->layout.get_width(column);
+            memcpy(this->address(this->layout.get_offset(column) + (record_id - 1U) * width), bytes, width);
+        }
+        bytes += sizes[column];
+    }
+    put_presence(record_id, 1);
+}
+
+/**
+ * Delete a record from the page.
+ * Its presence byte is cleared so add() can reuse the id, and its TEXT values are released. If it is the
+ * last record id in the block, it and any deleted ids just before it are dropped.
+ * @param record_id  record to delete
+ */
+void PaxPage::del(RecordID record_id) {
+    if (!is_live(record_id))
+        return;
+    u16 size, loc;
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+            get_text(record_id, column, size, loc);
+            put_text(record_id, column, 0, 0);
+            release(loc, size);
+        }
+    }
+    put_presence(record_id, 0);
+    this->num_live--;
+    while (this->num_records > 0 && !is_live(this->num_records))
+        this->num_records--;
+}
+
+/**
+ * Replace a record with a forwarding stub. Its TEXT values are released and the stub goes in the heap
+ * in place of the first one.
+ * @param record_id     record that has been moved
+ * @param to_block_id   where it went
+ * @param to_record_id
+ * @throws DbBlockNoRoomError if there isn't room for the stub (or no TEXT column to keep it in)
+ */
+void PaxPage::forward(RecordID record_id, BlockID to_block_id, RecordID to_record_id) {
+    int stub_column = first_text_column();
+    if (stub_column < 0)
+        throw DbBlockNoRoomError("no TEXT column to keep a forwarding stub in");
+    u16 size, loc;
+    u32 freed = 0;
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+            get_text(record_id, column, size, loc);
+            freed += size;
+        }
+    }
+    if (FORWARD_SZ > contiguous_bytes() + this->fragmented + freed)
+        throw DbBlockNoRoomError("not enough room for forwarding stub");
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+            get_text(record_id, column, size, loc);
+            put_text(record_id, column, 0, 0);
+            release(loc, size);
+        }
+    }
+    char stub[FORWARD_SZ];
+    *(BlockID *) stub = to_block_id;
+    *(RecordID *) (stub + sizeof(BlockID)) = to_record_id;
+    put_text(record_id, (uint) stub_column, FORWARD_SZ, store_text(stub, FORWARD_SZ));
+    put_presence(record_id, FORWARDED);
+}
+
+/**
+ * Check if a record is a forwarding stub.
+ * @param record_id
+ * @param to_block_id   set to where the record went (if it is a stub)
+ * @param to_record_id
+ * @return              true if it is a stub
+ */
+bool PaxPage::get_forward(RecordID record_id, BlockID &to_block_id, RecordID &to_record_id) const {
+    if (!is_live(record_id) || get_presence(record_id) != FORWARDED)
+        return false;
+    const char *stub = view_field(record_id, (uint) first_text_column()).get_data();
+    to_block_id = *(const BlockID *) stub;
+    to_record_id = *(const RecordID *) (stub + sizeof(BlockID));
+    return true;
+}
+
+/**
+ * Sequence of all non-deleted record IDs.
+ * @return  sequence of IDs (freed by caller)
+ */
+RecordIDs *PaxPage::ids(void) const {
+    RecordIDs *vec = new RecordIDs();
+    vec->reserve(this->num_live);
+    for (RecordID record_id : live_ids())
+        vec->push_back(record_id);
+    return vec;
+}
+
+/**
+ * Next non-deleted record ID.
+ * @param record_id  id to start after (0 for the first one)
+ * @return           next id, or 0 if there are no more
+ */
+RecordID PaxPage::next_id(RecordID record_id) const {
+    while (record_id < this->num_records)
+        if (is_live(++record_id))
+            return record_id;
+    return 0;
+}
+
+/**
+ * Erase all the records
+ */
+void PaxPage::clear() {
+    this->num_records = 0;
+    this->num_live = 0;
+    this->end_free = (u16) (get_block_size() - 1);
+    this->fragmented = 0;
+    memset(this->address(this->layout.get_presence_offset()), 0, this->layout.get_capacity());
+}
+
+/**
+ * Count of non-deleted records
+ * @return number of current records
+ */
+u16 PaxPage::size() const {
+    return this->num_live;
+}
+
+/**
+ * Get the number of bytes left for TEXT values, including the fragmented bytes that would be reclaimed
+ * by compact(). Once every record slot is taken there is no room for anything, so that is 0.
+ * @return number of bytes
+ */
+u16 PaxPage::unused_bytes() const {
+    if (this->num_live == this->layout.get_capacity())
+        return 0;
+    return contiguous_bytes() + this->fragmented;
+}
+
+/**
+ * Check if the given block was laid out by a PaxPage.
+ * @param block  the block's memory
+ * @return       true if it is a PaxPage
+ */
+bool PaxPage::is_pax(const Dbt &block) {
+    return block.get_size() >= HEADER_SZ && *(const u16 *) block.get_data() == PAX_MAGIC;
+}
+
+/**
+ * Store the parts of the block header that aren't HeaderFields.
+ */
+void PaxPage::put_header() {
+    put_n(0, PAX_MAGIC);
+    put_n(2, this->layout.get_capacity());
+}
+
+/**
+ * Is the given record id in use (and not deleted)?
+ */
+bool PaxPage::is_live(RecordID record_id) const {
+    if (record_id == 0 || record_id > this->num_records)
+        return false;
+    return get_presence(record_id) != 0;
+}
+
+/**
+ * Get a record's presence byte.
+ */
+char PaxPage::get_presence(RecordID record_id) const {
+    return *(const char *) this->address(this->layout.get_presence_offset() + record_id - 1U);
+}
+
+/**
+ * Set a record's presence byte.
+ */
+void PaxPage::put_presence(RecordID record_id, char presence) {
+    *(char *) this->address(this->layout.get_presence_offset() + record_id - 1U) = presence;
+}
+
+/**
+ * Which column a forwarding stub is kept in.
+ * @return  position of the first TEXT column, or -1 if there isn't one
+ */
+int PaxPage::first_text_column() const {
+    for (uint column = 0; column < this->layout.get_column_count(); column++)
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT)
+            return (int) column;
+    return -1;
+}
+
+/**
+ * Get the size and offset of a record's TEXT value from its minipage.
+ */
+void PaxPage::get_text(RecordID record_id, uint column, u16 &size, u16 &loc) const {
+    u32 offset = this->layout.get_offset(column) + (record_id - 1U) * this->layout.get_width(column);
+    size = get_n(offset);
+    loc = get_n(offset + 2);
+}
+
+/**
+ * Store the size and offset of a record's TEXT value in its minipage.
+ */
+void PaxPage::put_text(RecordID record_id, uint column, u16 size, u16 loc) {
+    u32 offset = this->layout.get_offset(column) + (record_id - 1U) * this->layout.get_width(column);
+    put_n(offset, size);
+    put_n(offset + 2, loc);
+}
+
+/**
+ * Work out where each column's value is in a marshaled row.
+ * @param data   row marshaled by HeapTable
+ * @param sizes  set to the number of bytes of each column's value (TEXT length prefix included)
+ */
+void PaxPage::field_sizes(const Dbt &data, vector<u32> &sizes) const {
+    const char *bytes = (const char *) data.get_data();
+    u32 offset = 0;
+    sizes.resize(this->layout.get_column_count());
+    for (uint column = 0; column < this->layout.get_column_count(); column++) {
+        u32 size = this->layout.get_width(column);
+        if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+            if (offset + sizeof(u16) > data.get_size())
+                throw DbRelationError("record too short for its columns");
+            u16 length = *(const u16 *) (bytes + offset);
+            size = sizeof(u16) + (length == OVERFLOW_MARKER ? OVERFLOW_POINTER_SZ : length);
+        }
+        offset += size;
+        if (offset > data.get_size())
+            throw DbRelationError("record too short for its columns");
+        sizes[column] = size;
+    }
+}
+
+/**
+ * Get the number of bytes in the free space between the minipages and the TEXT heap.
+ * @return number of bytes that can be used without compacting
+ */
+u16 PaxPage::contiguous_bytes() const {
+    if (this->end_free + 1U <= this->layout.get_heap_start())
+        return 0;
+    return (u16) (this->end_free + 1U - this->layout.get_heap_start());
+}
+
+/**
+ * Give back the space used by a TEXT value that is no longer needed.
+ * If it borders the free space it is just absorbed, otherwise it is counted as fragmented.
+ * @param loc   where the unneeded data starts
+ * @param size  how many bytes are no longer needed
+ */
+void PaxPage::release(u16 loc, u16 size) {
+    if (loc == this->end_free + 1U)
+        this->end_free += size;
+    else
+        this->fragmented += size;
+}
+
+/**
+ * Copy a TEXT value into the free space. Caller has made sure it fits, compacting first if needed.
+ * @param bytes  marshaled value
+ * @param size   its size
+ * @return       where it went
+ */
+u16 PaxPage::store_text(const char *bytes, u16 size) {
+    if (size > contiguous_bytes())
+        compact();
+    this->end_free -= size;
+    u16 loc = this->end_free + 1U;
+    memcpy(this->address(loc), bytes, size);
+    return loc;
+}
+
+/**
+ * Squeeze out all the fragmented bytes by sliding the TEXT values up against the end of the block.
+ */
+void PaxPage::compact() {
+    // visit the values from the end of the block backwards so each one only ever moves to the right
+    vector<tuple<u16, RecordID, uint>> by_loc;
+    u16 size, loc;
+    for (RecordID record_id : live_ids()) {
+        for (uint column = 0; column < this->layout.get_column_count(); column++) {
+            if (this->layout.get_data_type(column) == ColumnAttribute::TEXT) {
+                get_text(record_id, column, size, loc);
+                if (loc != 0)
+                    by_loc.push_back(make_tuple(loc, record_id, column));
+            }
+        }
+    }
+    sort(by_loc.rbegin(), by_loc.rend());
+
+    u16 end = (u16) (get_block_size() - 1);
+    for (auto const &entry : by_loc) {
+        get_text(std::get<1>(entry), std::get<2>(entry), size, loc);
+        u16 new_loc = end + 1U - size;
+        if (new_loc != loc) {
+            memmove(this->address(new_loc), this->address(loc), size);
+            put_text(std::get<1>(entry), std::get<2>(entry), size, new_loc);
+        }
+        end = new_loc - 1U;
+    }
+    this->end_free = end;
+    this->fragmented = 0;
+}
+
+/**
+ * Get 2-byte integer at given offset in block.
+ */
+u16 PaxPage::get_n(u32 offset) const {
+    return *(u16 *) this->address(offset);
+}
+
+/**
+ * Put a 2-byte integer at given offset in block.
+ * @param offset number of bytes into the page
+ * @param n
+ */
+void PaxPage::put_n(u32 offset, u16 n) {
+    *(u16 *) this->address(offset) = n;
+}
+
+/**
+ * Make a void* pointer for a given offset into the data block.
+ * @param offset
+ * @return
+ */
+void *PaxPage::address(u32 offset) const {
+    return (void *) ((char *) this->block.get_data() + offset);
+}
+
+/**
+ * Test helper. Marshals an (INT, TEXT, BOOLEAN) row the way HeapTable does.
+ */
+static vector<char> test_pax_row(int32_t a, const string &b, bool c) {
+    vector<char> bytes(sizeof(a) + sizeof(u16) + b.size() + 1);
+    *(int32_t *) bytes.data() = a;
+    *(u16 *) (bytes.data() + sizeof(a)) = (u16) b.size();
+    memcpy(bytes.data() + sizeof(a) + sizeof(u16), b.data(), b.size());
+    bytes.back() = c;
+    return bytes;
+}
+
+/**
+ * Testing function for PaxPage.
+ * @return true if testing succeeded, false otherwise
+ */
+bool test_pax_page() {
+    ColumnAttributes column_attributes;
+    column_attributes.push_back(ColumnAttribute(ColumnAttribute::INT));
+    column_attributes.push_back(ColumnAttribute(ColumnAttribute::TEXT));
+    column_attributes.push_back(ColumnAttribute(ColumnAttribute::BOOLEAN));
+    PaxLayout layout(column_attributes, DbBlock::BLOCK_SZ);
+    char blank_space[DbBlock::BLOCK_SZ];
+    Dbt block_dbt(blank_space, sizeof(blank_space));
+    PaxPage page(block_dbt, 1, layout, true);
+    if (!PaxPage::is_pax(block_dbt))
+        return assertion_failure("new block not marked as pax");
+
+    // fill it up
+    vector<vector<char>> rows;
+    try {
+        for (;;) {
+            vector<char> row = test_pax_row((int32_t) rows.size() * 7, string(rows.size() % 50, 'a' + rows.size() % 26),
+                                            rows.size() % 3 == 0);
+            Dbt row_dbt(row.data(), (u32) row.size());
+            if (page.add(&row_dbt) != rows.size() + 1)
+                return assertion_failure("add id", (double) rows.size() + 1);
+            rows.push_back(row);
+        }
+    } catch (DbBlockNoRoomError &exc) {
+        // full now
+    }
+    if (rows.size() < 50 || page.size() != rows.size())
+        return assertion_failure("too few records fit", (double) rows.size());
+
+    // whole records and single columns come back
+    for (RecordID id = 1; id <= rows.size(); id++) {
+        RecordView record = page.view(id);
+        if (record.get_size() != rows[id - 1].size() || memcmp(record.get_data(), rows[id - 1].data(), record.get_size()))
+            return assertion_failure("view", id);
+        RecordView a = page.view_field(id, 0);
+        if (a.get_size() != sizeof(int32_t) || *(const int32_t *) a.get_data() != (id - 1) * 7)
+            return assertion_failure("view_field INT", id);
+        RecordView c = page.view_field(id, 2);
+        if (c.get_size() != 1 || *c.get_data() != ((id - 1) % 3 == 0))
+            return assertion_failure("view_field BOOLEAN", id);
+    }
+
+    // deletes free up the id and the TEXT bytes; a bigger put only fits after compaction
+    for (RecordID id = 2; id <= rows.size(); id += 2)
+        page.del(id);
+    if (!page.view(2).is_null() || page.get(2) != nullptr || page.next_id(1) != 3)
+        return assertion_failure("deleted record still there");
+    vector<char> big = test_pax_row(-1, string(page.unused_bytes() - 10, 'z'), true);
+    Dbt big_dbt(big.data(), (u32) big.size());
+    page.put(1, big_dbt);
+    if (page.fragmented != 0)
+        return assertion_failure("put did not compact");
+    Dbt small_dbt(rows[1].data(), (u32) rows[1].size());
+    if (page.add(&small_dbt) != 2)
+        return assertion_failure("add did not reuse a deleted record id");
+    RecordView record = page.view(1);
+    if (record.get_size() != big.size() || memcmp(record.get_data(), big.data(), big.size()) != 0)
+        return assertion_failure("get back after growing put");
+    for (RecordID id = 3; id <= rows.size(); id += 2) {
+        record = page.view(id);
+        if (record.get_size() != rows[id - 1].size() || memcmp(record.get_data(), rows[id - 1].data(), record.get_size()))
+            return assertion_failure("record moved by compaction", id);
+    }
+
+    // shrinking put, then empty it out
+    Dbt row_dbt(rows[0].data(), (u32) rows[0].size());
+    page.put(1, row_dbt);
+    if (page.view(1).get_size() != rows[0].size())
+        return assertion_failure("get back after shrinking put");
+
+    // a forwarding stub stays live until it is put over
+    BlockID to_block_id;
+    RecordID to_record_id;
+    page.forward(3, 7, 9);
+    if (!page.get_forward(3, to_block_id, to_record_id) || to_block_id != 7 || to_record_id != 9
+        || page.get_forward(1, to_block_id, to_record_id) || page.next_id(2) != 3)
+        return assertion_failure("forward");
+    page.put(3, row_dbt);
+    if (page.get_forward(3, to_block_id, to_record_id) || page.view(3).get_size() != rows[0].size())
+        return assertion_failure("put over forwarding stub");
+    RecordIDs *id_list = page.ids();
+    for (RecordID id : *id_list)
+        page.del(id);
+    delete id_list;
+    if (page.size() != 0 || page.num_records != 0 || page.next_id(0) != 0)
+        return assertion_failure("not empty after deleting everything");
+    if (page.add(&row_dbt) != 1)
+        return assertion_failure("add after deleting everything");
+
+    // and it reads back the same from its bits
+    PaxPage again(block_dbt, 1, layout);
+    if (again.size() != 1 || again.view(1).get_size() != rows[0].size())
+        return assertion_failure("reading existing block");
+    return true;
+}
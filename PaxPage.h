@@ -0,0 +1,174 @@
+/**
+ * @file PaxPage.h - Implementation of storage_engine with a heap file structure.
+ * PaxPage: DbBlock
+ *
+ * @see "Seattle University, CPSC5300, Spring 2022"
+ */
+#pragma once
+
+#include "storage_engine.h"
+
+/**
+ * @class PaxLayout - where the minipages go in every PaxPage of a given table and block size.
+ * Worked out once per file rather than once per block.
+ */
+class PaxLayout {
+public:
+    PaxLayout(const ColumnAttributes &column_attributes, u_int32_t block_size);
+
+    virtual ~PaxLayout() {}
+
+    u_int16_t get_capacity() const { return capacity; }
+
+    u_int32_t get_heap_start() const { return heap_start; }
+
+    u_int32_t get_presence_offset() const { return presence_offset; }
+
+    uint get_column_count() const { return (uint) data_types.size(); }
+
+    ColumnAttribute::DataType get_data_type(uint column) const { return data_types[column]; }
+
+    u_int32_t get_offset(uint column) const { return offsets[column]; }
+
+    u_int32_t get_width(uint column) const { return widths[column]; }
+
+protected:
+    static const u_int16_t TEXT_ESTIMATE = 32;  // bytes per TEXT value assumed when sizing the minipages
+
+    std::vector<ColumnAttribute::DataType> data_types;
+    std::vector<u_int32_t> offsets;
+    std::vector<u_int32_t> widths;
+    u_int16_t capacity;
+    u_int32_t presence_offset;
+    u_int32_t heap_start;
+};
+
+/**
+ * @class PaxPage - column-grouped (PAX) implementation of DbBlock.
+ *
+ *      Manage a database block that contains several records of one table, with the values of each column
+        kept together in their own minipage. Modeled after Ailamaki et al., "Weaving Relations for Cache
+        Performance", VLDB 2001.
+
+        Records go in and come out in the marshaled row format of HeapTable, so a PaxPage can stand in for
+        a SlottedPage. A scan that only needs a column or two can look at just those minipages with
+        view_field() instead of having the whole record put back together.
+
+        Record ids are handed out starting with 1; the ids of deleted records are handed out again.
+        The block header is:
+            Bytes 0x00 - 0x01: PAX_MAGIC (never a possible SlottedPage record count)
+            Bytes 0x02 - 0x03: capacity (number of records the minipages have room for)
+            Bytes 0x04 - 0x05: number of record ids in use (including deleted ones)
+            Bytes 0x06 - 0x07: number of live (undeleted) records
+            Bytes 0x08 - 0x09: offset to end of free space in the TEXT heap
+            Bytes 0x0A - 0x0B: number of fragmented bytes in the TEXT heap
+        followed by the minipages, each starting on a 4-byte boundary:
+            presence: 1 byte per record (0 if deleted, FORWARDED if it is a forwarding stub)
+            then one per column, in column order:
+                INT:     4-byte values
+                BOOLEAN: 1-byte values
+                TEXT:    2-byte size and 2-byte offset into the TEXT heap of the marshaled value
+        and finally the TEXT heap, which fills from the end of the block back toward the minipages.
+
+        A forwarding stub keeps the BlockID and RecordID the record was moved to in the TEXT heap, where
+        the record's first TEXT value would be. A table without TEXT columns has fixed-size records, which
+        never need to be moved.
+ */
+class PaxPage : public DbBlock {
+public:
+    static const u_int16_t PAX_MAGIC = 0xFFFF;
+    static const u_int16_t HEADER_SZ = 12;
+
+    PaxPage(Dbt &block, BlockID block_id, const PaxLayout &layout, bool is_new = false);
+
+    virtual ~PaxPage() {}
+
+    PaxPage(const PaxPage &other) = delete;  // the header fields point into the block's memory
+
+    PaxPage &operator=(const PaxPage &other) = delete;
+
+    virtual RecordID add(const Dbt *data);
+
+    virtual Dbt *get(RecordID record_id) const;
+
+    virtual RecordView view(RecordID record_id) const;
+
+    virtual void put(RecordID record_id, const Dbt &data);
+
+    virtual void del(RecordID record_id);
+
+    virtual void forward(RecordID record_id, BlockID to_block_id, RecordID to_record_id);
+
+    virtual bool get_forward(RecordID record_id, BlockID &to_block_id, RecordID &to_record_id) const;
+
+    virtual RecordIDs *ids(void) const;
+
+    virtual RecordID next_id(RecordID record_id) const;
+
+    virtual void clear();
+
+    virtual u_int16_t size() const;
+
+    virtual u_int16_t unused_bytes() const;
+
+    /**
+     * Look at one column's marshaled value for a record without putting the whole record back together.
+     * @param record_id  which record
+     * @param column     which column (by position)
+     * @returns          view into the block's memory (is_null() if the record has been deleted)
+     */
+    virtual RecordView view_field(RecordID record_id, uint column) const;
+
+    /**
+     * Check if the given block was laid out by a PaxPage.
+     * @param block  the block's memory
+     * @returns      true if it is a PaxPage
+     */
+    static bool is_pax(const Dbt &block);
+
+protected:
+    static const char FORWARDED = 2;  // presence byte of a forwarding stub
+    static const u_int16_t FORWARD_SZ = sizeof(BlockID) + sizeof(RecordID);
+
+    const PaxLayout &layout;
+    // the block header, read and written right in the block's memory
+    HeaderField num_records;
+    HeaderField num_live;
+    HeaderField end_free;
+    HeaderField fragmented;
+    mutable std::vector<char> record;  // where view() and get() put records back together
+
+    void put_header();
+
+    bool is_live(RecordID record_id) const;
+
+    char get_presence(RecordID record_id) const;
+
+    void put_presence(RecordID record_id, char presence);
+
+    int first_text_column() const;
+
+    void get_text(RecordID record_id, uint column, u_int16_t &size, u_int16_t &loc) const;
+
+    void put_text(RecordID record_id, uint column, u_int16_t size, u_int16_t loc);
+
+    void field_sizes(const Dbt &data, std::vector<u_int32_t> &sizes) const;
+
+    u_int16_t contiguous_bytes() const;
+
+    void release(u_int16_t loc, u_int16_t size);
+
+    u_int16_t store_text(const char *bytes, u_int16_t size);
+
+    virtual void compact();
+
+    u_int16_t get_n(u_int32_t offset) const;
+
+    void put_n(u_int32_t offset, u_int16_t n);
+
+    void *address(u_int32_t offset) const;
+
+    friend bool test_pax_page();
+};
+
+bool test_pax_page();
@@ -17,6 +17,24 @@ using namespace hsql;
 Tables *SQLExec::tables = nullptr;
 Indices *SQLExec::indices = nullptr;
 
+// print one value of a query result
+static void print_value(ostream &out, const Value &value) {
+    switch (value.data_type) {
+        case ColumnAttribute::INT:
+            out << value.n;
+            break;
+        case ColumnAttribute::TEXT:
+            out << "\"" << value.s << "\"";
+            break;
+        case ColumnAttribute::BOOLEAN:
+            out << (value.n == 0 ? "false" : "true");
+            break;
+        default:
+            out << "???";
+    }
+    out << " ";
+}
+
 // make query result be printable
 ostream &operator<<(ostream &out, const QueryResult &qres) {
     if (qres.column_names != nullptr) {
@@ -26,25 +44,30 @@ ostream &operator<<(ostream &out, const QueryResult &qres) {
         for (unsigned int i = 0; i < qres.column_names->size(); i++)
             out << "----------+";
         out << endl;
-        for (auto const &row: *qres.rows) {
-            for (auto const &column_name: *qres.column_names) {
-                Value value = row->at(column_name);
-                switch (value.data_type) {
-                    case ColumnAttribute::INT:
-                        out << value.n;
-                        break;
-                    case ColumnAttribute::TEXT:
-                        out << "\"" << value.s << "\"";
-                        break;
-                    case ColumnAttribute::BOOLEAN:
-                        out << (value.n == 0 ? "false" : "true");
-                        break;
-                    default:
-                        out << "???";
+        if (qres.stream != nullptr) {
+            // streamed rows are already in column order, so they are printed by position and then freed
+            ValueDicts::size_type count = 0;
+            try {
+                for (Row *row = qres.stream->next(); row != nullptr; row = qres.stream->next()) {
+                    for (auto const &value: *row)
+                        print_value(out, value);
+                    out << endl;
+                    delete row;
+                    count++;
                 }
-                out << " ";
+            } catch (DbRelationError &e) {
+                // the rows are only gotten from the tables now, after SQLExec::execute is done
+                throw SQLExecError(string("DbRelationError: ") + e.what());
+            } catch (DbException &e) {
+                throw SQLExecError(string("DbException: ") + e.what());
+            }
+            out << "successfully returned " << count << " rows";
+        } else {
+            for (auto const &row: *qres.rows) {
+                for (auto const &column_name: *qres.column_names)
+                    print_value(out, row->at(column_name));
+                out << endl;
             }
-            out << endl;
         }
     }
     out << qres.message;
@@ -61,6 +84,7 @@ QueryResult::~QueryResult() {
             delete row;
         delete rows;
     }
+    delete stream;
 }
 
 
@@ -93,6 +117,15 @@ QueryResult *SQLExec::execute(const SQLStatement *statement) {
     }
 }
 
+// Flush the tables and indices statements have used, along with _tables, _columns and _indices.
+void SQLExec::flush() {
+    if (SQLExec::tables == nullptr)
+        return;  // no statement has run yet
+    Tables::flush_all();
+    SQLExec::indices->flush();
+    Indices::flush_all();
+}
+
 QueryResult *SQLExec::insert(const InsertStatement *statement) {
     // Get the table with the same name
     Identifier table_name = statement->tableName;
@@ -212,7 +245,10 @@ QueryResult *SQLExec::del(const DeleteStatement *statement) {
     delete plan;
     EvalPipeline pipeline = optimized->pipeline();
     delete optimized;
-    Handles *handles = pipeline.second;
+    Handles *handles = new Handles();  // all of them before deleting any, so the scan doesn't see its own deletes
+    for (Handle handle; pipeline.second->next(handle);)
+        handles->push_back(handle);
+    delete pipeline.second;
 
     // Delete indices first, then table
     IndexNames index_names = SQLExec::indices->get_index_names(table_name);
@@ -266,11 +302,15 @@ QueryResult *SQLExec::select(const SelectStatement *statement) {
     {
         plan = new EvalPlan(get_where_conjunction(statement->whereClause), plan);
     }
-    plan = new EvalPlan(column_names, plan);
-    // Evaluate the optimized plan
-    ValueDicts *rows = plan->optimize()->evaluate();
+    ColumnNames *result_column_names = new ColumnNames(*column_names);
+    plan = new EvalPlan(column_names, plan);  // takes column_names
+    // Evaluate the optimized plan, getting the rows as they are printed
+    EvalPlan *optimized = plan->optimize();
+    delete plan;
+    EvalRows *rows = optimized->stream();
+    delete optimized;
 
-    return new QueryResult(column_names, column_attributes, rows, "successfully returned " + to_string(rows->size()) + " rows");
+    return new QueryResult(result_column_names, column_attributes, rows);
 }
 
 void SQLExec::column_definition(const ColumnDefinition *col, Identifier &column_name, ColumnAttribute &column_attribute) {
@@ -9,6 +9,7 @@
 #include <string>
 #include "SQLParser.h"
 #include "schema_tables.h"
+#include "EvalPlan.h"
 
 /**
  * @class SQLExecError - exception for SQLExec methods
@@ -21,16 +22,26 @@ public:
 
 /**
  * @class QueryResult - data structure to hold all the returned data for a query execution
+ *
+ * The rows of a SELECT are streamed: they are only gotten from the tables as the result is printed, so they
+ * are never all in memory at once and the first ones show up right away. They come as Rows, with their
+ * values in the order of column_names. Such a result can only be printed once, and get_rows() is nullptr
+ * for it.
  */
 class QueryResult {
 public:
-    QueryResult() : column_names(nullptr), column_attributes(nullptr), rows(nullptr), message("") {}
+    QueryResult() : column_names(nullptr), column_attributes(nullptr), rows(nullptr), stream(nullptr), message("") {}
 
     QueryResult(std::string message) : column_names(nullptr), column_attributes(nullptr), rows(nullptr),
-                                       message(message) {}
+                                       stream(nullptr), message(message) {}
 
     QueryResult(ColumnNames *column_names, ColumnAttributes *column_attributes, ValueDicts *rows, std::string message)
-            : column_names(column_names), column_attributes(column_attributes), rows(rows), message(message) {}
+            : column_names(column_names), column_attributes(column_attributes), rows(rows), stream(nullptr),
+              message(message) {}
+
+    QueryResult(ColumnNames *column_names, ColumnAttributes *column_attributes, EvalRows *stream)
+            : column_names(column_names), column_attributes(column_attributes), rows(nullptr), stream(stream),
+              message("") {}
 
     virtual ~QueryResult();
 
@@ -40,6 +51,8 @@ public:
 
     ValueDicts *get_rows() const { return rows; }
 
+    EvalRows *get_stream() const { return stream; }
+
     const std::string &get_message() const { return message; }
 
     friend std::ostream &operator<<(std::ostream &stream, const QueryResult &qres);
@@ -48,6 +61,7 @@ protected:
     ColumnNames *column_names;
     ColumnAttributes *column_attributes;
     ValueDicts *rows;
+    EvalRows *stream;  // rows not gotten yet, for a streamed result
     std::string message;
 };
 
@@ -64,6 +78,11 @@ public:
      */
     static QueryResult *execute(const hsql::SQLStatement *statement);
 
+    /**
+     * Write out the changes to every table and index in use that are still only in memory.
+     */
+    static void flush();
+
 protected:
     // the one place in the system that holds the _tables table and _indices table
     static Tables *tables;
@@ -3,11 +3,13 @@
  * @author K Lundeen
  * @see Seattle University, CPSC5300
  */
+#include <algorithm>
 #include <cstring>
 #include "SlottedPage.h"
 
 using namespace std;
 typedef uint16_t u16;
+typedef uint32_t u32;
 
 /**
  * SlottedPage constructor
@@ -15,30 +17,97 @@ typedef uint16_t u16;
  * @param block_id
  * @param is_new
  */
-SlottedPage::SlottedPage(Dbt &block, BlockID block_id, bool is_new) : DbBlock(block, block_id, is_new) {
+SlottedPage::SlottedPage(Dbt &block, BlockID block_id, bool is_new)
+        : DbBlock(block, block_id, is_new), num_records(address(0)), end_free(address(2)), fragmented(address(4)),
+          free_slot(address(6)), num_live(address(8)), row_format(address(10)) {
     if (is_new) {
         this->num_records = 0;
-        this->end_free = DbBlock::BLOCK_SZ - 1;
-        put_header();
-    } else {
-        get_header(this->num_records, this->end_free);
+        this->end_free = (u16) (get_block_size() - 1);
+        this->fragmented = 0;
+        this->free_slot = 0;
+        this->num_live = 0;
+        this->row_format = 0;
     }
 }
 
+/**
+ * Copies share the block's memory, so the header fields are pointed at the copy's block rather than copied.
+ * @param other
+ */
+SlottedPage::SlottedPage(const SlottedPage &other)
+        : DbBlock(other), num_records(address(0)), end_free(address(2)), fragmented(address(4)),
+          free_slot(address(6)), num_live(address(8)), row_format(address(10)) {}
+
+SlottedPage &SlottedPage::operator=(const SlottedPage &other) {
+    DbBlock::operator=(other);
+    this->num_records.point_at(address(0));
+    this->end_free.point_at(address(2));
+    this->fragmented.point_at(address(4));
+    this->free_slot.point_at(address(6));
+    this->num_live.point_at(address(8));
+    this->row_format.point_at(address(10));
+    return *this;
+}
+
 /**
  * Add a new record to the block.
+ * The record id of a deleted record is handed out again if there is one, otherwise a new one is made.
  * @param data
  * @return the new block's id
  */
 RecordID SlottedPage::add(const Dbt *data) {
-    if (!has_room((u16) data->get_size()))
+    if (!fits(data))
         throw DbBlockNoRoomError("not enough room for new record");
-    u16 id = ++this->num_records;
+    return place(data);
+}
+
+/**
+ * Add as many of the given records as will fit, in order.
+ * @param records     the data to store, one Dbt per record
+ * @param count       number of records
+ * @param record_ids  the ids of the records that were added get appended to this
+ * @return            how many were added
+ */
+u32 SlottedPage::add_batch(const Dbt *records, u32 count, RecordIDs &record_ids) {
+    u32 added = 0;
+    while (added < count && fits(&records[added]))
+        record_ids.push_back(place(&records[added++]));
+    return added;
+}
+
+/**
+ * Check if add() would be able to fit the given record in, possibly after compacting.
+ * @param data
+ * @return true if there is room
+ */
+bool SlottedPage::fits(const Dbt *data) const {
+    u32 needed = room((u16) data->get_size()) + (this->free_slot == 0 ? 4U : 0U);  // a reused slot already has its header
+    return needed <= unused_bytes();
+}
+
+/**
+ * Store a new record that fits() and give it an id.
+ * @param data
+ * @return the new record's id
+ */
+RecordID SlottedPage::place(const Dbt *data) {
     u16 size = (u16) data->get_size();
-    this->end_free -= size;
-    u16 loc = this->end_free + 1U;
-    put_header();
-    put_header(id, size, loc);
+    u32 needed = room(size) + (this->free_slot == 0 ? 4U : 0U);
+    if (needed > contiguous_bytes())
+        compact();  // the room is there, but only after reclaiming the fragmented bytes
+    u16 id;
+    if (this->free_slot != 0) {
+        u16 next, loc;
+        id = this->free_slot;
+        get_header(next, loc, id);
+        this->free_slot = next;
+    } else {
+        id = ++this->num_records;
+    }
+    this->num_live++;
+    u32 loc = data_start() - room(size);
+    this->end_free = (u16) (loc - 1U);
+    put_header(id, size, (u16) loc);
     memcpy(this->address(loc), data->get_data(), size);
     return id;
 }
@@ -56,8 +125,26 @@ Dbt *SlottedPage::get(RecordID record_id) const {
     return new Dbt(this->address(loc), size);
 }
 
+/**
+ * Look at a record in the block without copying it.
+ * @param record_id
+ * @return view of the bits of the record as stored in the block, or a null view if it has been deleted
+ */
+RecordView SlottedPage::view(RecordID record_id) const {
+    u16 size, loc;
+    get_header(size, loc, record_id);
+    if (loc == 0)
+        return RecordView();  // this is just a tombstone, record has been deleted
+    return RecordView(this->address(loc), size);
+}
+
 /**
  * Replace the record with the given data.
+ *
+ * A smaller record is rewritten in place (right-justified in its old spot) and the bytes it no longer
+ * needs are released. A larger record is written to the free space and its old spot is released; the
+ * block is only compacted if that is the only way to make it fit.
+ *
  * @param record_id   record to replace
  * @param data        new contents of record_id
  * @throws DbBlockNoRoomError if it won't fit
@@ -66,33 +153,101 @@ void SlottedPage::put(RecordID record_id, const Dbt &data) {
     u16 size, loc;
     get_header(size, loc, record_id);
     u16 new_size = (u16) data.get_size();
-    if (new_size > size) {
-        u16 extra = new_size - size;
-        if (!has_room(extra))
-            throw DbBlockNoRoomError("not enough room for enlarged record");
-        slide(loc, loc - extra);
-        memcpy(this->address(loc - extra), data.get_data(), new_size);
+    u16 old_room = room(size), new_room = room(new_size);
+    if (new_room > old_room && !has_room(new_room - old_room))
+        throw DbBlockNoRoomError("not enough room for enlarged record");
+    if (new_room <= old_room) {
+        u16 new_loc = loc + (old_room - new_room);
+        memcpy(this->address(new_loc), data.get_data(), new_size);
+        release(loc, old_room - new_room);
+        put_header(record_id, new_size, new_loc);
     } else {
-        memcpy(this->address(loc), data.get_data(), new_size);
-        slide(loc + new_size, loc + size);
+        u16 extra = new_room - old_room;
+        u32 new_loc;
+        if (loc == data_start() && extra <= contiguous_bytes()) {
+            // record is right next to the free space, so just grow it to the left
+            new_loc = loc - extra;
+        } else {
+            put_header(record_id, 0, 0);  // old copy is garbage now
+            release(loc, old_room);
+            if (new_room > contiguous_bytes())
+                compact();
+            new_loc = data_start() - new_room;
+        }
+        this->end_free = (u16) (new_loc - 1U);
+        memcpy(this->address(new_loc), data.get_data(), new_size);
+        put_header(record_id, new_size, (u16) new_loc);
     }
-    get_header(size, loc, record_id);
-    put_header(record_id, new_size, loc);
 }
 
 /**
  * Delete a record from the page.
  *
- * Mark the given id as deleted by changing its size to zero and its location to 0.
- * Compact the rest of the data in the block. But keep the record ids the same for everyone.
+ * Mark the given id as deleted by changing its location to 0 and put it on the free-slot chain (the size
+ * of a tombstone is the id of the next free slot, or 0 at the end of the chain) so add() can reuse it.
+ * If it is the last record id in the block, it and any tombstones just before it are dropped from the
+ * end of the headers instead.
+ * The record's bytes are just released; the rest of the data in the block is not moved until
+ * the space is actually needed. Record ids stay the same for everyone else.
  *
  * @param record_id  record to delete
  */
 void SlottedPage::del(RecordID record_id) {
     u16 size, loc;
     get_header(size, loc, record_id);
-    put_header(record_id, 0, 0);  // 0 is the tombstone sentinel
-    slide(loc, loc + size);
+    if (loc == 0)
+        return;  // already a tombstone
+    this->num_live--;
+    release(loc, room(size));
+    if (record_id == this->num_records) {
+        this->num_records--;
+        bool trimmed_free_slots = false;
+        while (this->num_records > 0) {
+            get_header(size, loc, this->num_records);
+            if (loc != 0)
+                break;
+            this->num_records--;
+            trimmed_free_slots = true;
+        }
+        if (trimmed_free_slots)
+            unlink_trimmed_slots();
+    } else {
+        put_header(record_id, this->free_slot, 0);  // 0 location is the tombstone sentinel
+        this->free_slot = record_id;
+    }
+}
+
+/**
+ * Replace a record with a forwarding stub. Done with put(), and every record has room() for a stub, so
+ * it always fits.
+ * @param record_id     record that has been moved
+ * @param to_block_id   where it went
+ * @param to_record_id
+ */
+void SlottedPage::forward(RecordID record_id, BlockID to_block_id, RecordID to_record_id) {
+    char stub[FORWARD_SZ];
+    *(BlockID *) stub = to_block_id;
+    *(RecordID *) (stub + sizeof(BlockID)) = to_record_id;
+    Dbt stub_dbt(stub, FORWARD_SZ);
+    put(record_id, stub_dbt);
+    put_n(header_offset(record_id), FORWARD);
+}
+
+/**
+ * Check if a record is a forwarding stub.
+ * @param record_id
+ * @param to_block_id   set to where the record went (if it is a stub)
+ * @param to_record_id
+ * @return              true if it is a stub
+ */
+bool SlottedPage::get_forward(RecordID record_id, BlockID &to_block_id, RecordID &to_record_id) const {
+    u32 offset = header_offset(record_id);
+    if (get_n(offset) != FORWARD)
+        return false;
+    const char *stub = (const char *) this->address(get_n(offset + 2));
+    to_block_id = *(const BlockID *) stub;
+    to_record_id = *(const RecordID *) (stub + sizeof(BlockID));
+    return true;
 }
 
 /**
@@ -101,13 +256,25 @@ void SlottedPage::del(RecordID record_id) {
  */
 RecordIDs *SlottedPage::ids(void) const {
     RecordIDs *vec = new RecordIDs();
+    vec->reserve(this->num_live);
+    for (RecordID record_id : live_ids())
+        vec->push_back(record_id);
+    return vec;
+}
+
+/**
+ * Next non-deleted record ID.
+ * @param record_id  id to start after (0 for the first one)
+ * @return           next id, or 0 if there are no more
+ */
+RecordID SlottedPage::next_id(RecordID record_id) const {
     u16 size, loc;
-    for (RecordID record_id = 1; record_id <= this->num_records; record_id++) {
-        get_header(size, loc, record_id);
+    while (record_id < this->num_records) {
+        get_header(size, loc, ++record_id);
         if (loc != 0)
-            vec->push_back(record_id);
+            return record_id;
     }
-    return vec;
+    return 0;
 }
 
 /**
@@ -115,8 +282,10 @@ RecordIDs *SlottedPage::ids(void) const {
  */
 void SlottedPage::clear() {
     this->num_records = 0;
-    this->end_free = DbBlock::BLOCK_SZ - 1;
-    put_header();
+    this->end_free = (u16) (get_block_size() - 1);
+    this->fragmented = 0;
+    this->free_slot = 0;
+    this->num_live = 0;
 }
 
 /**
@@ -124,41 +293,46 @@ void SlottedPage::clear() {
  * @return number of current records
  */
 u16 SlottedPage::size() const {
-    u16 size, loc;
-    u16 count = 0;
-    for (RecordID record_id = 1; record_id <= this->num_records; record_id++) {
-        get_header(size, loc, record_id);
-        if (loc != 0)
-            count++;
-    }
-    return count;
+    return this->num_live;
 }
 
 
 /**
- * Get the size and offset for given id. For id of zero, it is the block header.
- * @param size  set to the size from given header
+ * Get the size and offset for given id. For id of zero, it is the number of records and end of free space
+ * from the block header.
+ * @param size  set to the size from given header (the real size of the stub for a forwarding stub)
  * @param loc   set to the byte offset from given header
  * @param id    the id of the header to fetch
  */
 void SlottedPage::get_header(u_int16_t &size, u_int16_t &loc, RecordID id) const {
-    size = get_n((u16) 4 * id);
-    loc = get_n((u16) (4 * id + 2));
+    u32 offset = header_offset(id);
+    size = get_n(offset);
+    loc = get_n(offset + 2);
+    if (size == FORWARD && id != 0)
+        size = FORWARD_SZ;
 }
 
 /**
- * Store the size and offset for given id. For id of zero, store the block header.
+ * Store the size and offset for given id.
  * @param id
  * @param size
  * @param loc
  */
 void SlottedPage::put_header(RecordID id, u16 size, u16 loc) {
-    if (id == 0) { // called the put_header() version and using the default params
-        size = this->num_records;
-        loc = this->end_free;
-    }
-    put_n((u16) 4 * id, size);
-    put_n((u16) (4 * id + 2), loc);
+    u32 offset = header_offset(id);
+    put_n(offset, size);
+    put_n(offset + 2, loc);
+}
+
+/**
+ * Where the header for the given id starts. Record headers follow the block header.
+ * @param id  record id, or zero for the block header
+ * @return    byte offset into the block
+ */
+u32 SlottedPage::header_offset(RecordID id) const {
+    if (id == 0)
+        return 0;
+    return HEADER_SZ + 4U * (id - 1U);
 }
 
 /**
@@ -167,16 +341,52 @@ void SlottedPage::put_header(RecordID id, u16 size, u16 loc) {
  * @param size   size of the new record (not including the header space needed)
  * @return       true if there is enough room, false otherwise
  */
-bool SlottedPage::has_room(u16 size) const {
-    return size + (u16)4 <= this->unused_bytes();
+bool SlottedPage::has_room(u32 size) const {
+    return size + 4U <= this->unused_bytes();
 }
 
 /**
  * Get the number of bytes not currently used to store data or for overhead.
+ * This includes the fragmented bytes that would be reclaimed by compact().
  * @return number of bytes
  */
 u16 SlottedPage::unused_bytes() const {
-    u16 headers = (u16) (4 * (this->num_records + 1));
+    return contiguous_bytes() + this->fragmented;
+}
+
+/**
+ * Get the row format stamped on the block (the format itself is up to the file's user).
+ * @return the row format, or 0 if none was ever stamped
+ */
+u16 SlottedPage::get_row_format() const {
+    return this->row_format;
+}
+
+/**
+ * Stamp a row format on the block. It is left alone by everything else, including clear().
+ * @param row_format  the row format the block's records are in
+ */
+void SlottedPage::set_row_format(u16 row_format) {
+    this->row_format = row_format;
+}
+
+/**
+ * Read the row format stamped on a block without making a SlottedPage of it.
+ * @param block  the block's bytes (not a PaxPage)
+ * @return       the row format, or 0 if none was ever stamped
+ */
+u16 SlottedPage::row_format_of(const Dbt &block) {
+    u16 row_format;
+    memcpy(&row_format, (const char *) block.get_data() + 10, sizeof(row_format));
+    return row_format;
+}
+
+/**
+ * Get the number of bytes in the free space between the headers and the data.
+ * @return number of bytes that can be used without compacting
+ */
+u16 SlottedPage::contiguous_bytes() const {
+    u32 headers = header_offset(this->num_records + 1);
     u16 unused;
     if (this->end_free <= headers)
         unused = 0;
@@ -186,47 +396,73 @@ u16 SlottedPage::unused_bytes() const {
 }
 
 /**
- * Slide the contents to compensate for a smaller/larger record.
- *
- * If start < end, then remove data from offset start up to but not including offset end by sliding data
- * that is to the left of start to the right. If start > end, then make room for extra data from end to start
- * by sliding data that is to the left of start to the left.
- * Also fix up any record headers whose data has slid. Assumes there is enough room if it is a left
- * shift (end < start).
- *
- * @param start  beginning of slide
- * @param end    end of slide
- */
-void SlottedPage::slide(u_int16_t start, u_int16_t end) {
-    int shift = end - start;
-    if (shift == 0)
-        return;
-
-    // slide data
-    void *to = this->address((u16) (this->end_free + 1 + shift));
-    void *from = this->address((u16) (this->end_free + 1));
-    int bytes = start - (this->end_free + 1U);
-    memmove(to, from, bytes);
-
-    // fix up headers to the right
-    RecordIDs *record_ids = ids();
-    for (auto const &record_id : *record_ids) {
-        u16 size, loc;
+ * Give back the space used by some record data that is no longer needed.
+ * If it borders the free space it is just absorbed, otherwise it is counted as fragmented.
+ * @param loc   where the unneeded data starts
+ * @param size  how many bytes are no longer needed
+ */
+void SlottedPage::release(u16 loc, u16 size) {
+    if (loc == data_start())
+        this->end_free += size;
+    else
+        this->fragmented += size;
+}
+
+/**
+ * Take any slots that were just trimmed off the end of the headers out of the free-slot chain.
+ * Their old headers (with the chain links) are still intact, since nothing has been written over them yet.
+ */
+void SlottedPage::unlink_trimmed_slots() {
+    RecordID prev = 0;
+    RecordID slot = this->free_slot;
+    while (slot != 0) {
+        u16 next, loc;
+        get_header(next, loc, slot);
+        if (slot > this->num_records) {
+            if (prev == 0)
+                this->free_slot = next;
+            else
+                put_header(prev, next, 0);
+        } else {
+            prev = slot;
+        }
+        slot = next;
+    }
+}
+
+/**
+ * Squeeze out all the fragmented bytes by sliding the live records up against the end of the block.
+ * Record ids stay the same for everyone; only their locations change.
+ */
+void SlottedPage::compact() {
+    // visit the records from the end of the block backwards so each one only ever moves to the right
+    vector<pair<u16, RecordID>> by_loc;
+    by_loc.reserve(this->num_live);
+    u16 size, loc;
+    for (RecordID record_id : live_ids()) {
         get_header(size, loc, record_id);
-        if (loc <= start) {
-            loc += shift;
-            put_header(record_id, size, loc);
+        by_loc.push_back(make_pair(loc, record_id));
+    }
+    sort(by_loc.rbegin(), by_loc.rend());
+
+    u32 start = get_block_size();  // where the records slid over so far start
+    for (auto const &entry : by_loc) {
+        get_header(size, loc, entry.second);
+        u32 new_loc = start - room(size);
+        if (new_loc != loc) {
+            memmove(this->address(new_loc), this->address(loc), size);
+            put_n(header_offset(entry.second) + 2, (u16) new_loc);  // size stays as is (it may be FORWARD)
         }
+        start = new_loc;
     }
-    delete record_ids;
-    this->end_free += shift;
-    put_header();
+    this->end_free = (u16) (start - 1U);
+    this->fragmented = 0;
 }
 
 /**
  * Get 2-byte integer at given offset in block.
  */
-u16 SlottedPage::get_n(u16 offset) const {
+u16 SlottedPage::get_n(u32 offset) const {
     return *(u16 *) this->address(offset);
 }
 
@@ -235,7 +471,7 @@ u16 SlottedPage::get_n(u16 offset) const {
  * @param offset number of bytes into the page
  * @param n
  */
-void SlottedPage::put_n(u16 offset, u16 n) {
+void SlottedPage::put_n(u32 offset, u16 n) {
     *(u16 *) this->address(offset) = n;
 }
 
@@ -244,7 +480,7 @@ void SlottedPage::put_n(u16 offset, u16 n) {
  * @param offset
  * @return
  */
-void *SlottedPage::address(u16 offset) const {
+void *SlottedPage::address(u32 offset) const {
     return (void *) ((char *) this->block.get_data() + offset);
 }
 
@@ -287,6 +523,9 @@ bool test_slotted_page() {
     delete get_dbt;
     if (expected != actual)
         return assertion_failure("get 1 back " + actual);
+    RecordView view = slot.view(id);
+    if (view.get_size() != sizeof(rec1) || memcmp(view.get_data(), rec1, sizeof(rec1)) != 0)
+        return assertion_failure("view 1");
 
     // add another record and fetch it back
     char rec2[] = "goodbye";
@@ -345,12 +584,14 @@ bool test_slotted_page() {
     delete id_list;
     slot.del(1);
     id_list = slot.ids();
-    if (id_list->size() != 1 || id_list->at(0) != 2)
+    if (id_list->size() != 1 || id_list->at(0) != 2 || slot.size() != 1)
         return assertion_failure("ids() with 1 record remaining");
     delete id_list;
     get_dbt = slot.get(1);
     if (get_dbt != nullptr)
         return assertion_failure("get of deleted record was not null");
+    if (!slot.view(1).is_null())
+        return assertion_failure("view of deleted record was not null");
 
     // try adding something too big
     rec2_dbt = Dbt(nullptr, DbBlock::BLOCK_SZ - 10); // too big, but only because we have a record in there
@@ -364,6 +605,106 @@ bool test_slotted_page() {
         return assertion_failure("wrong type thrown when add too big");
     }
 
+    // deletes leave holes which are only squeezed out when an add needs the room
+    char frag_space[DbBlock::BLOCK_SZ];
+    Dbt frag_dbt(frag_space, sizeof(frag_space));
+    SlottedPage frag(frag_dbt, 1, true);
+    char filler[100];
+    RecordID frag_count = 0;
+    try {
+        for (;;) {
+            memset(filler, 'a' + frag_count % 26, sizeof(filler));
+            Dbt filler_dbt(filler, sizeof(filler));
+            frag.add(&filler_dbt);
+            frag_count++;
+        }
+    } catch (DbBlockNoRoomError &exc) {
+        // full now
+    }
+    for (RecordID frag_id = 1; frag_id <= frag_count; frag_id += 2)
+        frag.del(frag_id);
+    if (frag.fragmented == 0)
+        return assertion_failure("del did not leave holes");
+    char big[300];
+    memset(big, 'z', sizeof(big));
+    Dbt big_dbt(big, sizeof(big));
+    RecordID big_id = frag.add(&big_dbt);
+    if (frag.fragmented != 0)
+        return assertion_failure("add did not compact");
+    if (big_id % 2 == 0 || big_id > frag_count)
+        return assertion_failure("add did not reuse a deleted record id", big_id);
+    big_dbt = Dbt(big, 10);
+    frag.put(big_id, big_dbt);  // shrink in place
+    if (frag.view(big_id).get_size() != 10 || memcmp(frag.view(big_id).get_data(), big, 10) != 0)
+        return assertion_failure("get back after shrinking put");
+    for (RecordID frag_id = 2; frag_id <= frag_count; frag_id += 2) {
+        memset(filler, 'a' + (frag_id - 1) % 26, sizeof(filler));
+        RecordView record = frag.view(frag_id);
+        if (record.get_size() != sizeof(filler) || memcmp(record.get_data(), filler, sizeof(filler)) != 0)
+            return assertion_failure("record moved by compaction", frag_id);
+    }
+    BlockID to_block_id;
+    RecordID to_record_id;
+    frag.forward(2, 7, 9);
+    if (!frag.get_forward(2, to_block_id, to_record_id) || to_block_id != 7 || to_record_id != 9
+        || frag.get_forward(4, to_block_id, to_record_id) || frag.next_id(1) != 2)
+        return assertion_failure("forward");
+    frag.compact();
+    if (!frag.get_forward(2, to_block_id, to_record_id) || to_record_id != 9)
+        return assertion_failure("forwarding stub lost by compaction");
+    for (RecordID frag_id = 2; frag_id <= frag_count; frag_id += 2)
+        frag.del(frag_id);
+    frag.del(big_id);
+    if (frag.num_records != 0 || frag.free_slot != 0 || frag.size() != 0)
+        return assertion_failure("trailing tombstones not trimmed", frag.num_records, frag.free_slot);
+    if (frag.add(&big_dbt) != 1)
+        return assertion_failure("add after trimming everything");
+
+    // a batch goes in up to the first record that doesn't fit, with the block header written once
+    char batch_space[DbBlock::BLOCK_SZ];
+    Dbt batch_block(batch_space, sizeof(batch_space));
+    SlottedPage batch(batch_block, 1, true);
+    vector<Dbt> batch_records(2 * frag_count, Dbt(filler, sizeof(filler)));
+    RecordIDs batch_ids;
+    u32 batch_count = batch.add_batch(batch_records.data(), (u32) batch_records.size(), batch_ids);
+    if (batch_count != frag_count || batch_ids.size() != batch_count || batch_ids.back() != batch_count)
+        return assertion_failure("add_batch", batch_count, frag_count);
+    SlottedPage batch_again(batch_block, 1);
+    if (batch_again.size() != batch_count || memcmp(batch_again.view(batch_count).get_data(), filler, sizeof(filler)))
+        return assertion_failure("add_batch header");
+
+    // biggest blocks need offsets all the way up to 0xFFFF
+    vector<char> huge_space(DbBlock::MAX_BLOCK_SZ);
+    Dbt huge_dbt(huge_space.data(), DbBlock::MAX_BLOCK_SZ);
+    SlottedPage huge(huge_dbt, 1, true);
+    vector<char> huge_rec(25000, 'h');
+    Dbt huge_rec_dbt(huge_rec.data(), 20000);
+    for (RecordID huge_id = 1; huge_id <= 3; huge_id++)
+        if (huge.add(&huge_rec_dbt) != huge_id)
+            return assertion_failure("add to biggest block", huge_id);
+    huge.del(2);
+    huge_rec_dbt = Dbt(huge_rec.data(), 25000);
+    huge.put(1, huge_rec_dbt);  // only fits after compaction
+    if (huge.view(1).get_size() != 25000 || huge.view(3).get_size() != 20000
+        || memcmp(huge.view(3).get_data(), huge_rec.data(), 20000) != 0)
+        return assertion_failure("put into biggest block");
+
+    // an empty biggest block has its data starting right past the last offset a uint16_t holds
+    SlottedPage emptied(huge_dbt, 2, true);
+    huge_rec_dbt = Dbt(huge_rec.data(), 20000);
+    emptied.del(emptied.add(&huge_rec_dbt));
+    emptied.compact();
+    if (emptied.data_start() != DbBlock::MAX_BLOCK_SZ || emptied.size() != 0)
+        return assertion_failure("emptied biggest block", emptied.data_start());
+    RecordID emptied_id = emptied.add(&huge_rec_dbt);
+    huge_rec_dbt = Dbt(huge_rec.data(), 25000);
+    emptied.put(emptied_id, huge_rec_dbt);  // grows to the left in place
+    if (emptied.data_start() != DbBlock::MAX_BLOCK_SZ - 25000 || emptied.view(emptied_id).get_size() != 25000)
+        return assertion_failure("put into emptied biggest block", emptied.data_start());
+    emptied.del(emptied_id);
+    if (emptied.data_start() != DbBlock::MAX_BLOCK_SZ || emptied.unused_bytes() != emptied.contiguous_bytes())
+        return assertion_failure("del from emptied biggest block", emptied.data_start());
+
     // more volume
     string gettysburg = "Four score and seven years ago our fathers brought forth on this continent, a new nation, conceived in Liberty, and dedicated to the proposition that all men are created equal.";
     int32_t n = -1;
@@ -392,13 +733,11 @@ bool test_slotted_page() {
     for (const auto &slot : page_list) {
         RecordIDs *ids = slot.ids();
         for (RecordID id : *ids) {
-            Dbt *record = slot.get(id);
-            if (record->get_size() != total_size)
+            RecordView record = slot.view(id);
+            if (record.get_size() != total_size)
                 return assertion_failure("more volume wrong size", block_id - 1, id);
-            void *stored = record->get_data();
-            if (memcmp(stored, data, total_size) != 0)
+            if (memcmp(record.get_data(), data, total_size) != 0)
                 return assertion_failure("more volume wrong data", block_id - 1, id);
-            delete record;
         }
         delete ids;
         delete[] (char *) slot.block.get_data();  // this is why we need to be a friend--just convenient
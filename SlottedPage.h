@@ -17,56 +17,125 @@
  *      Manage a database block that contains several records.
         Modeled after slotted-page from Database Systems Concepts, 6ed, Figure 10-9.
 
+        The block can be anywhere from DbBlock::MIN_BLOCK_SZ to DbBlock::MAX_BLOCK_SZ bytes (taken from the
+        size of the Dbt it is given). The 2-byte sizes and offsets below cover every byte of even the
+        largest (64 KiB) block. The end of such a block is one past what they can hold, so where the record
+        data starts (see data_start()) and any arithmetic on it is always done with 4-byte integers.
+
         Record id are handed out sequentially starting with 1 as records are added with add().
         Each record has a header which is a fixed offset from the beginning of the block:
             Bytes 0x00 - Ox01: number of records
             Bytes 0x02 - 0x03: offset to end of free space
-            Bytes 0x04 - 0x05: size of record 1
-            Bytes 0x06 - 0x07: offset to record 1
+            Bytes 0x04 - 0x05: number of fragmented bytes (freed, but not yet reclaimed by compaction)
+            Bytes 0x06 - 0x07: first deleted record id on the free-slot chain (0 if none)
+            Bytes 0x08 - 0x09: number of live (undeleted) records
+            Bytes 0x0A - 0x0B: row format the records are in (whatever the file's user stamps there; 0 if never)
+            Bytes 0x0C - 0x0D: size of record 1
+            Bytes 0x0E - 0x0F: offset to record 1
             etc.
+        A deleted record has an offset of 0 and its size is reused to link to the next free slot. Deleted
+        record ids are handed out again by add(), and deleted ones at the end of the headers are trimmed off.
+        A record that has been moved elsewhere by forward() has a size of FORWARD (too big for any real
+        record) and its data is the BlockID and RecordID it was moved to. Every record takes up at least
+        FORWARD_SZ bytes of the block, even if it is shorter, so it can always be replaced by a stub.
+
+        Deletes and shrinking puts leave holes behind rather than sliding the rest of the data over.
+        The holes are squeezed out all at once, and only when an add or put needs the room.
  *
  */
 class SlottedPage : public DbBlock {
 public:
     SlottedPage(Dbt &block, BlockID block_id, bool is_new = false);
 
-    // Big 5 - use the defaults
     virtual ~SlottedPage() {}
 
+    SlottedPage(const SlottedPage &other);
+
+    SlottedPage &operator=(const SlottedPage &other);
+
     virtual RecordID add(const Dbt *data);
 
+    virtual u_int32_t add_batch(const Dbt *records, u_int32_t count, RecordIDs &record_ids);
+
     virtual Dbt *get(RecordID record_id) const;
 
+    virtual RecordView view(RecordID record_id) const;
+
     virtual void put(RecordID record_id, const Dbt &data);
 
     virtual void del(RecordID record_id);
 
+    virtual void forward(RecordID record_id, BlockID to_block_id, RecordID to_record_id);
+
+    virtual bool get_forward(RecordID record_id, BlockID &to_block_id, RecordID &to_record_id) const;
+
     virtual RecordIDs *ids(void) const;
 
+    virtual RecordID next_id(RecordID record_id) const;
+
     virtual void clear();
 
     virtual u_int16_t size() const;
 
     virtual u_int16_t unused_bytes() const;
 
+    virtual u_int16_t get_row_format() const;
+
+    virtual void set_row_format(u_int16_t row_format);
+
+    static u_int16_t row_format_of(const Dbt &block);
 
 protected:
-    uint16_t num_records;
-    uint16_t end_free;
+    static const uint16_t HEADER_SZ = 12;  // size of the block header (before the record headers)
+    static const uint16_t FORWARD = 0xFFFF;  // record header size of a forwarding stub
+    static const uint16_t FORWARD_SZ = sizeof(BlockID) + sizeof(RecordID);  // its real size
+
+    // the block header, read and written right in the block's memory
+    HeaderField num_records;
+    HeaderField end_free;
+    HeaderField fragmented;
+    HeaderField free_slot;
+    HeaderField num_live;
+    HeaderField row_format;
 
     void get_header(uint16_t &size, uint16_t &loc, RecordID id = 0) const;
 
-    void put_header(RecordID id = 0, uint16_t size = 0, uint16_t loc = 0);
+    void put_header(RecordID id, uint16_t size, uint16_t loc);
+
+    uint32_t header_offset(RecordID id) const;
+
+    bool has_room(uint32_t size) const;
+
+    /**
+     * How many bytes of the block a record of the given size takes up.
+     * @param size  the record's size
+     * @return      its size, but never less than FORWARD_SZ
+     */
+    static uint16_t room(uint16_t size) { return size < FORWARD_SZ ? FORWARD_SZ : size; }
+
+    /**
+     * Where the record data starts: just past the free space, or the end of the block if there is no data.
+     * @return offset of the first byte of record data (can be 0x10000, so never keep it in a uint16_t)
+     */
+    uint32_t data_start() const { return this->end_free + 1U; }
+
+    bool fits(const Dbt *data) const;
+
+    RecordID place(const Dbt *data);
+
+    uint16_t contiguous_bytes() const;
+
+    void release(uint16_t loc, uint16_t size);
 
-    bool has_room(uint16_t size) const;
+    void unlink_trimmed_slots();
 
-    virtual void slide(uint16_t start, uint16_t end);
+    virtual void compact();
 
-    uint16_t get_n(uint16_t offset) const;
+    uint16_t get_n(uint32_t offset) const;
 
-    void put_n(uint16_t offset, uint16_t n);
+    void put_n(uint32_t offset, uint16_t n);
 
-    void *address(uint16_t offset) const;
+    void *address(uint32_t offset) const;
 
     friend bool test_slotted_page();
 };
@@ -0,0 +1,356 @@
+/**
+ * @file StripedFile.cpp
+ * @see Seattle University, CPSC5300
+ */
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "StripedFile.h"
+
+using namespace std;
+typedef uint32_t u32;
+
+/**
+ * Constructor
+ * @param directories  where the stripes go, one per directory ("" for the environment's home)
+ */
+Tablespace::Tablespace(vector<string> directories) : directories() {
+    set_directories(directories);
+}
+
+/**
+ * Change where the stripes of files created from now on go.
+ * @param directories  one per stripe ("" for the environment's home)
+ */
+void Tablespace::set_directories(vector<string> directories) {
+    if (directories.empty())
+        throw DbRelationError("a tablespace needs at least one directory");
+    this->directories = directories;
+}
+
+/**
+ * The tablespace HeapTable puts striped tables in. It starts out as just the environment's home.
+ * @return  the one shared Tablespace
+ */
+Tablespace &Tablespace::shared() {
+    static Tablespace tablespace;
+    return tablespace;
+}
+
+/**
+ * Constructor
+ * @param name
+ * @param tablespace         where to put the stripes if the file gets created (copied)
+ * @param block_size         size of the blocks if the file gets created
+ * @param column_attributes  layout of the records, needed to read PaxPage blocks (kept by the caller)
+ * @param pax                true to use PaxPage blocks if the file gets created
+ * @param free_space_map     true to keep a FreeSpaceMap for append() to use
+ * @param pool               where the file's blocks are cached
+ */
+StripedFile::StripedFile(string name, const Tablespace &tablespace, u32 block_size,
+                         const ColumnAttributes *column_attributes, bool pax, bool free_space_map, BufferPool &pool)
+        : HeapFile(name, block_size, column_attributes, pax, free_space_map, pool),
+          directories(tablespace.get_directories()), stripes() {
+    this->dbfilename = layout_path(name);
+}
+
+StripedFile::~StripedFile() {
+    close();
+}
+
+/**
+ * Delete the stripes and the file saying where they are.
+ */
+void StripedFile::drop(void) {
+    release_tail();
+    this->pool.discard(this);  // no point writing them back
+    close();
+    for (u32 stripe = 0; stripe < this->directories.size(); stripe++) {
+        Db db(_DB_ENV, 0);
+        db.remove(stripe_path(stripe).c_str(), nullptr, 0);
+    }
+    ::unlink(this->dbfilename.c_str());
+    if (this->free_space != nullptr)
+        this->free_space->drop();
+}
+
+/**
+ * Write the file's blocks out of the buffer pool and close the stripes.
+ */
+void StripedFile::close(void) {
+    if (this->closed)
+        return;
+    release_tail();
+    this->pool.flush(this);
+    this->pool.discard(this);
+    close_stripes();
+    if (this->free_space != nullptr)
+        this->free_space->close();
+    this->closed = true;
+}
+
+/**
+ * Read a block from whichever stripe it is in.
+ * @param block_id
+ * @param data      where to put it
+ * @param size      the block size
+ */
+void StripedFile::read_page(BlockID block_id, char *data, u32 size) {
+    db_recno_t recno = record_of(block_id);
+    Dbt key(&recno, sizeof(recno));
+    Dbt dbt(data, size);
+    dbt.set_ulen(size);
+    dbt.set_flags(DB_DBT_USERMEM);
+    this->stripes[stripe_of(block_id)]->get(nullptr, &key, &dbt, 0);
+}
+
+/**
+ * Write a block to whichever stripe it is in.
+ * @param block_id
+ * @param data      the block
+ * @param size      the block size
+ */
+void StripedFile::write_page(BlockID block_id, const char *data, u32 size) {
+    db_recno_t recno = record_of(block_id);
+    Dbt key(&recno, sizeof(recno));
+    Dbt dbt((void *) data, size);
+    this->stripes[stripe_of(block_id)]->put(nullptr, &key, &dbt, 0);
+}
+
+/**
+ * Read a run of blocks in order, from all the stripes at once.
+ * @param range  blocks to read (any past the last block are skipped)
+ * @return       the scan (freed by caller, before the file is closed)
+ */
+BlockScan *StripedFile::scan(BlockIDRange range) {
+    range = range.subrange(1, this->last);
+    if (this->read_ahead > 1 && !range.empty())
+        return new StripedBlockScan(*this, range, this->read_ahead);
+    return new BlockScan(*this, range);
+}
+
+/**
+ * Check if a table has a StripedFile.
+ * @param name  the file's name
+ * @return      true if <name>.stripes is there
+ */
+bool StripedFile::exists(string name) {
+    struct stat st;
+    return ::stat(layout_path(name).c_str(), &st) == 0;
+}
+
+/**
+ * Open the stripes (and create them, and the file saying where they are, depending on the flags).
+ * @param flags  Berkeley DB flags
+ */
+void StripedFile::db_open(uint flags) {
+    if (!this->closed)
+        return;
+    if (flags & DB_CREATE) {
+        write_layout();
+    } else {
+        ifstream in(this->dbfilename);
+        if (!in)
+            throw DbException((this->dbfilename + ": " + strerror(ENOENT)).c_str(), ENOENT);
+        this->directories.clear();
+        string directory;
+        while (getline(in, directory))
+            this->directories.push_back(directory);
+        if (this->directories.empty())
+            throw DbRelationError(this->dbfilename + " has no stripes");
+    }
+
+    try {
+        for (u32 stripe = 0; stripe < this->directories.size(); stripe++) {
+            Db *db = new Db(_DB_ENV, 0);
+            this->stripes.push_back(db);
+            db->set_re_len(this->block_size); // record length - will be ignored if file already exists
+            db->open(nullptr, stripe_path(stripe).c_str(), nullptr, DB_RECNO, flags, 0644);
+            db->get_re_len(&this->block_size); // so pick up whatever the file was created with
+        }
+        this->last = this->allocated = flags ? 0 : get_block_count();
+        vector<char> first(this->block_size);
+        Dbt data(first.data(), this->block_size);
+        if (this->last > 0)
+            read_page(1, first.data(), this->block_size);
+        opened(this->last > 0 ? &data : nullptr);
+    } catch (...) {
+        close_stripes();
+        if (flags & DB_CREATE)
+            ::unlink(this->dbfilename.c_str());  // only just written, by write_layout()
+        throw;
+    }
+    reclaim_tail();
+}
+
+/**
+ * Number of blocks in the file: the blocks up to the first one missing from its stripe.
+ * @return number of blocks
+ */
+uint32_t StripedFile::get_block_count() {
+    u32 count = UINT32_MAX;
+    u32 stripe_count = (u32) this->stripes.size();
+    for (u32 stripe = 0; stripe < stripe_count; stripe++) {
+        DB_BTREE_STAT *stat;
+        this->stripes[stripe]->stat(nullptr, &stat, DB_FAST_STAT);
+        u32 first_missing = stat->bt_ndata * stripe_count + stripe + 1;
+        free(stat);
+        if (first_missing - 1 < count)
+            count = first_missing - 1;
+    }
+    return count;
+}
+
+/**
+ * Add an extent of empty blocks to the end of the file (spread over the stripes like any other blocks).
+ */
+void StripedFile::preallocate() {
+    init_empty_block();
+    for (u32 i = 0; i < EXTENT_BLOCKS; i++)
+        write_page(++this->allocated, this->empty_block.data(), this->block_size);
+}
+
+/**
+ * Where a stripe is.
+ * @param stripe  which one
+ * @return        its Berkeley DB file name (relative to the environment's home if its directory is "")
+ */
+string StripedFile::stripe_path(u32 stripe) const {
+    string file = this->name + "." + to_string(stripe) + ".db";
+    const string &directory = this->directories[stripe];
+    return directory.empty() ? file : directory + "/" + file;
+}
+
+/**
+ * Sync all the stripes to disk.
+ */
+void StripedFile::sync(void) {
+    for (auto db: this->stripes)
+        db->sync(0);
+}
+
+/**
+ * Write the file saying where the stripes are, for a file being created. It must not be there already,
+ * since that would mean the file exists and its stripes may be somewhere else.
+ * @throws DbException if it is there already or can't be written
+ */
+void StripedFile::write_layout() {
+    int fd = ::open(this->dbfilename.c_str(), O_WRONLY | O_CREAT | O_EXCL, 0644);
+    if (fd < 0)
+        throw DbException((this->dbfilename + ": " + strerror(errno)).c_str(), errno);
+    string layout;
+    for (auto const &directory: this->directories)
+        layout += directory + '\n';
+    ssize_t written = ::write(fd, layout.data(), layout.size());
+    int error = written < 0 ? errno : EIO;
+    ::close(fd);
+    if (written != (ssize_t) layout.size()) {
+        ::unlink(this->dbfilename.c_str());
+        throw DbException((this->dbfilename + ": " + strerror(error)).c_str(), error);
+    }
+}
+
+/**
+ * Close all the stripes that are open.
+ */
+void StripedFile::close_stripes() {
+    for (auto db: this->stripes) {
+        db->close(0);
+        delete db;
+    }
+    this->stripes.clear();
+}
+
+/**
+ * Where the file saying where a StripedFile's stripes are is: in the database environment's home directory.
+ * @param name  the file's name
+ * @return      the path
+ */
+string StripedFile::layout_path(string name) {
+    return env_path(name + ".stripes");
+}
+
+/**
+ * Constructor
+ * @param file        the file to read
+ * @param range       which of its blocks (not empty)
+ * @param read_ahead  how many blocks to get from Berkeley DB at a time, over all the stripes
+ */
+StripedBlockScan::StripedBlockScan(StripedFile &file, BlockIDRange range, u32 read_ahead)
+        : BlockScan(file, range), striped_file(file), cursors(file.stripes.size()) {
+    u32 per_stripe = read_ahead / (u32) this->cursors.size();
+    // room for the blocks plus Berkeley DB's bookkeeping, in a multiple of 1KB as it insists
+    size_t size = (size_t) (per_stripe < 1 ? 1 : per_stripe) * (file.block_size + 64);
+    for (u32 stripe = 0; stripe < this->cursors.size(); stripe++) {
+        Cursor &cursor = this->cursors[stripe];
+        cursor.cursor = nullptr;
+        cursor.buffer.resize((size + 1023) / 1024 * 1024);
+        cursor.batch = nullptr;
+        cursor.first_recno = 0;
+        cursor.started = false;
+        file.stripes[stripe]->cursor(nullptr, &cursor.cursor, 0);
+    }
+}
+
+StripedBlockScan::~StripedBlockScan() {
+    for (auto &cursor: this->cursors) {
+        delete cursor.batch;
+        if (cursor.cursor != nullptr)
+            cursor.cursor->close();
+    }
+}
+
+/**
+ * Get the next block.
+ * @return  the block (freed by caller, before calling next() again), or nullptr once there are no more
+ */
+DbBlock *StripedBlockScan::next() {
+    if (this->next_id > this->last_id)
+        return nullptr;
+    BlockID block_id = this->next_id++;
+    Cursor &cursor = this->cursors[this->striped_file.stripe_of(block_id)];
+    db_recno_t wanted = this->striped_file.record_of(block_id);
+    if (cursor.first_recno == 0)
+        cursor.first_recno = wanted;
+    db_recno_t recno = 0;
+    Dbt data;
+    while (recno < wanted) {
+        if (cursor.batch == nullptr && !fill(cursor))
+            break;
+        if (!cursor.batch->next(recno, data)) {
+            delete cursor.batch;
+            cursor.batch = nullptr;
+        }
+    }
+    if (recno != wanted) {
+        this->next_id = this->last_id + 1;  // the stripe ran out early
+        return nullptr;
+    }
+    DbBlock *block = pooled(block_id);
+    if (block == nullptr)
+        block = this->striped_file.make_block(data, block_id);
+    return block;
+}
+
+/**
+ * Get the next bunch of records from a stripe into its buffer.
+ * @param cursor  the stripe's cursor
+ * @return        false if there aren't any more
+ */
+bool StripedBlockScan::fill(Cursor &cursor) {
+    db_recno_t recno = cursor.first_recno;
+    Dbt key(&recno, sizeof(recno));
+    cursor.bulk.set_data(cursor.buffer.data());
+    cursor.bulk.set_ulen((u32) cursor.buffer.size());
+    cursor.bulk.set_flags(DB_DBT_USERMEM);
+    int ret = cursor.cursor->get(&key, &cursor.bulk, (cursor.started ? DB_NEXT : DB_SET) | DB_MULTIPLE_KEY);
+    cursor.started = true;
+    if (ret == DB_NOTFOUND)
+        return false;
+    cursor.batch = new DbMultipleRecnoDataIterator(cursor.bulk);
+    return true;
+}
@@ -0,0 +1,146 @@
+/**
+ * @file StripedFile.h - HeapFile striped across several Berkeley DB files.
+ * Tablespace
+ * StripedFile: HeapFile
+ * StripedBlockScan: BlockScan
+ *
+ * @see "Seattle University, CPSC5300, Spring 2022"
+ */
+#pragma once
+
+#include "HeapFile.h"
+
+/**
+ * @class Tablespace - the directories a StripedFile's blocks are spread over, ideally each on its own disk
+ *
+ * An empty directory means the database environment's home. The same directory can be given more than
+ * once (each stripe is its own file), though that only spreads the blocks over files, not disks.
+ */
+class Tablespace {
+public:
+    explicit Tablespace(std::vector<std::string> directories = {""});
+
+    virtual ~Tablespace() {}
+
+    virtual const std::vector<std::string> &get_directories() const { return directories; }
+
+    virtual void set_directories(std::vector<std::string> directories);
+
+    static Tablespace &shared();
+
+protected:
+    std::vector<std::string> directories;
+};
+
+/**
+ * @class StripedFile - heap file whose blocks are dealt out round-robin to one Berkeley DB RecNo file per
+ * directory of a Tablespace
+ *
+ * Block n is record (n - 1) / stripes + 1 of stripe (n - 1) % stripes, kept in <directory>/<name>.<stripe>.db,
+ * so a run of blocks is spread evenly over all the stripes. Only read_page() and write_page() know about
+ * that; everything above them sees block ids just as in HeapFile. Scans read from every stripe in turn, in
+ * bulk, so a big scan gets the bandwidth of all the disks the stripes are on.
+ *
+ * Which directories the stripes are in is kept in <name>.stripes in the environment's home, so an existing
+ * file is always opened with the stripes it was created with, whatever tablespace it is given.
+ */
+class StripedFile : public HeapFile {
+public:
+    StripedFile(std::string name, const Tablespace &tablespace = Tablespace::shared(),
+                u_int32_t block_size = DbBlock::BLOCK_SZ, const ColumnAttributes *column_attributes = nullptr,
+                bool pax = false, bool free_space_map = false, BufferPool &pool = BufferPool::shared());
+
+    virtual ~StripedFile();
+
+    StripedFile(const StripedFile &other) = delete;
+
+    StripedFile(StripedFile &&temp) = delete;
+
+    StripedFile &operator=(const StripedFile &other) = delete;
+
+    StripedFile &operator=(StripedFile &&temp) = delete;
+
+    virtual void drop(void);
+
+    virtual void close(void);
+
+    virtual void read_page(BlockID block_id, char *data, u_int32_t size);
+
+    virtual void write_page(BlockID block_id, const char *data, u_int32_t size);
+
+    virtual BlockScan *scan(BlockIDRange range);
+
+    /**
+     * Get the number of stripes the file is spread over.
+     * @return number of stripes
+     */
+    virtual u_int32_t get_stripe_count() const { return (u_int32_t) directories.size(); }
+
+    static bool exists(std::string name);
+
+protected:
+    std::vector<std::string> directories;  // where each stripe is
+    std::vector<Db *> stripes;             // each stripe's file while it is open
+
+    virtual void db_open(uint flags = 0);
+
+    virtual uint32_t get_block_count();
+
+    virtual void preallocate();
+
+    virtual std::string stripe_path(u_int32_t stripe) const;
+
+    virtual void write_layout();
+
+    virtual void close_stripes();
+
+    virtual void sync(void);
+
+    /**
+     * Which stripe a block is in.
+     */
+    virtual u_int32_t stripe_of(BlockID block_id) const { return (block_id - 1) % directories.size(); }
+
+    /**
+     * Which record of its stripe a block is.
+     */
+    virtual db_recno_t record_of(BlockID block_id) const { return (block_id - 1) / directories.size() + 1; }
+
+    static std::string layout_path(std::string name);
+
+    friend class StripedBlockScan;
+};
+
+/**
+ * @class StripedBlockScan - reads a run of a StripedFile's blocks in order, with a Berkeley DB cursor per
+ * stripe getting read_ahead / stripes records at a time in bulk (DB_MULTIPLE_KEY)
+ *
+ * As with BulkBlockScan, a block that is in the buffer pool is used from there, and the rest are used right
+ * where they are in the bulk buffers and are not put in the pool.
+ */
+class StripedBlockScan : public BlockScan {
+public:
+    StripedBlockScan(StripedFile &file, BlockIDRange range, u_int32_t read_ahead);
+
+    virtual ~StripedBlockScan();
+
+    virtual DbBlock *next();
+
+protected:
+    /**
+     * Where the scan is in one stripe.
+     */
+    struct Cursor {
+        Dbc *cursor;
+        std::vector<char> buffer;
+        Dbt bulk;
+        DbMultipleRecnoDataIterator *batch;  // what is left of the last bulk get, or nullptr for none
+        db_recno_t first_recno;              // record the scan starts at in this stripe (0 until it gets there)
+        bool started;
+    };
+
+    StripedFile &striped_file;
+    std::vector<Cursor> cursors;
+
+    virtual bool fill(Cursor &cursor);
+};
@@ -68,6 +68,11 @@ void BTreeIndex::close() {
     }
 }
 
+// Write out the index's changes that are still only in memory.
+void BTreeIndex::flush() {
+    file.flush();
+}
+
 // Find all the rows whose columns are equal to key. Assumes key is a dictionary whose keys are the column
 // names in the index. Returns a list of row handles.
 Handles *BTreeIndex::lookup(ValueDict *key_dict) const {
@@ -22,6 +22,8 @@ public:
 
     virtual void close();
 
+    virtual void flush();
+
     virtual Handles *lookup(ValueDict *key) const;
 
     virtual Handles *range(ValueDict *min_key, ValueDict *max_key) const;
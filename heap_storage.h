@@ -1,6 +1,7 @@
 /**
  * @file heap_storage.h - Implementation of storage_engine with a heap file structure.
  * SlottedPage: DbBlock
+ * PaxPage: DbBlock
  * HeapFile: DbFile
  * HeapTable: DbRelation
  *
@@ -9,6 +10,11 @@
  */
 #pragma once
 #include "SlottedPage.h"
+#include "PaxPage.h"
 #include "HeapFile.h"
+#include "MappedFile.h"
+#include "DirectFile.h"
+#include "CompressedFile.h"
+#include "StripedFile.h"
 #include "HeapTable.h"
 
@@ -164,6 +164,12 @@ DbRelation &Tables::get_table(Identifier table_name) {
     return *table;
 }
 
+// Flush every table we've constructed.
+void Tables::flush_all() {
+    for (auto const &entry: Tables::table_cache)
+        entry.second->flush();
+}
+
 
 /*
  * ****************************
@@ -411,6 +417,12 @@ DbIndex &Indices::get_index(Identifier table_name, Identifier index_name) {
     return *index;
 }
 
+// Flush every index we've constructed.
+void Indices::flush_all() {
+    for (auto const &entry: Indices::index_cache)
+        entry.second->flush();
+}
+
 IndexNames Indices::get_index_names(Identifier table_name) {
     IndexNames ret;
     ValueDict where;
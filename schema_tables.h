@@ -60,6 +60,12 @@ public:
      */
     static DbRelation &get_table(Identifier table_name);
 
+    /**
+     * Write out the changes still only in memory of every table get_table() has handed out (and of
+     * _tables and _columns themselves).
+     */
+    static void flush_all();
+
 protected:
     // hard-coded columns for _tables table
     static ColumnNames &COLUMN_NAMES();
@@ -144,6 +150,11 @@ public:
      */
     virtual IndexNames get_index_names(Identifier table_name);
 
+    /**
+     * Write out the changes still only in memory of every index get_index() has handed out.
+     */
+    static void flush_all();
+
     // overrides
     virtual Handle insert(const ValueDict *row);
 
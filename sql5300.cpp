@@ -60,7 +60,12 @@ int main(int argc, char *argv[]) {
                 try {
                     cout << ParseTreeToString::statement(statement) << endl;
                     QueryResult *result = SQLExec::execute(statement);
-                    cout << *result << endl;
+                    try {
+                        cout << *result << endl;
+                    } catch (SQLExecError &e) {
+                        delete result;  // a streamed result can still fail while it is printed
+                        throw;
+                    }
                     delete result;
                 } catch (SQLExecError &e) {
                     cout << "Error: " << e.what() << endl;
@@ -68,6 +73,11 @@ int main(int argc, char *argv[]) {
             }
         }
         delete parse;
+        try {
+            SQLExec::flush();  // so nothing is lost if the shell never gets to quit
+        } catch (DbException &e) {
+            cout << "Error: " << e.what() << endl;
+        }
     }
     return EXIT_SUCCESS;
 }
@@ -6,12 +6,53 @@
 #include <algorithm>
 #include "storage_engine.h"
 
+/**
+ * Where a file of ours that Berkeley DB doesn't open for us goes: in _DB_ENV's home, if it has one.
+ * @param file_name  the file's name
+ * @return           the path to it
+ */
+std::string env_path(const std::string &file_name) {
+    const char *home = nullptr;
+    if (_DB_ENV != nullptr)
+        _DB_ENV->get_home(&home);
+    if (home == nullptr || *home == '\0')
+        return file_name;
+    return std::string(home) + "/" + file_name;
+}
+
+// Add records one at a time until one doesn't fit
+u_int32_t DbBlock::add_batch(const Dbt *records, u_int32_t count, RecordIDs &record_ids) {
+    u_int32_t added = 0;
+    try {
+        for (; added < count; added++)
+            record_ids.push_back(add(&records[added]));
+    } catch (DbBlockNoRoomError &e) {
+        // block is full
+    }
+    return added;
+}
+
+// Cut a range into nearly equal consecutive pieces (fewer of them if there aren't enough blocks)
+std::vector<BlockIDRange> BlockIDRange::split(u_int32_t parts) const {
+    std::vector<BlockIDRange> ret;
+    u_int32_t n = size();
+    if (parts > n)
+        parts = n;
+    BlockID next = this->first;
+    for (u_int32_t i = 0; i < parts; i++) {
+        u_int32_t count = n / parts + (i < n % parts ? 1 : 0);
+        ret.push_back(BlockIDRange(next, next + count - 1));
+        next += count;
+    }
+    return ret;
+}
+
 bool Value::operator==(const Value &other) const {
     if (this->data_type != other.data_type)
         return false;
-    if (this->data_type == ColumnAttribute::INT)
-        return this->n == other.n;
-    return this->s == other.s;
+    if (this->data_type == ColumnAttribute::TEXT)
+        return this->s == other.s;
+    return this->n == other.n;  // INT or BOOLEAN
 }
 
 bool Value::operator!=(const Value &other) const {
@@ -64,6 +105,40 @@ ColumnAttributes *DbRelation::get_column_attributes(const ColumnNames &select_co
     return ret;
 }
 
+// Find out where the given columns are
+ColumnOrdinals *DbRelation::get_column_ordinals(const ColumnNames &select_column_names) const {
+    ColumnOrdinals *ret = new ColumnOrdinals();
+    ret->reserve(select_column_names.size());
+    for (auto const &column_name: select_column_names) {
+        auto it = std::find(this->column_names.begin(), this->column_names.end(), column_name);
+        if (it == this->column_names.end()) {
+            delete ret;
+            throw DbRelationError("unknown column " + column_name);
+        }
+        ret->push_back((uint) (it - this->column_names.begin()));
+    }
+    return ret;
+}
+
+// Key a row's values by their column names
+ValueDict *DbRelation::to_value_dict(const Row &row, const ColumnOrdinals &columns) const {
+    ValueDict *ret = new ValueDict();
+    for (size_t i = 0; i < columns.size(); i++)
+        (*ret)[this->column_names[columns[i]]] = row[i];
+    return ret;
+}
+
+// Pick the columns out of the whole row (subclasses that can get at them directly should)
+Row *DbRelation::project_row(Handle handle, const ColumnOrdinals &columns) {
+    ValueDict *values = project(handle);
+    Row *row = new Row();
+    row->reserve(columns.size());
+    for (uint column: columns)
+        row->push_back(values->at(this->column_names[column]));
+    delete values;
+    return row;
+}
+
 // Just pulls out the column names from a ValueDict and passes that to the usual form of project().
 ValueDict *DbRelation::project(Handle handle, const ValueDict *where) {
     ColumnNames t;
@@ -72,8 +147,19 @@ ValueDict *DbRelation::project(Handle handle, const ValueDict *where) {
     return this->project(handle, &t);
 }
 
+// Find the rows of a selection (by default, all at once with select())
+SelectCursor *DbRelation::select_cursor(const ValueDict *where) {
+    return new HandlesCursor(where == nullptr ? select() : select(where));
+}
+
+// Refine the rows of another cursor, a batch at a time
+SelectCursor *DbRelation::select_cursor(SelectCursor *current_selection, const ValueDict *where) {
+    return new FilterCursor(*this, current_selection, where);
+}
+
 // Do a projection for each of a list of handles
 ValueDicts *DbRelation::project(Handles *handles) {
+    prefetch(handles);
     ValueDicts *ret = new ValueDicts();
     for (auto const &handle: *handles)
         ret->push_back(project(handle));
@@ -82,6 +168,7 @@ ValueDicts *DbRelation::project(Handles *handles) {
 
 // Do a projection for each of a list of handles
 ValueDicts *DbRelation::project(Handles *handles, const ColumnNames *column_names) {
+    prefetch(handles);
     ValueDicts *ret = new ValueDicts();
     for (auto const &handle: *handles)
         ret->push_back(project(handle, column_names));
@@ -90,6 +177,7 @@ ValueDicts *DbRelation::project(Handles *handles, const ColumnNames *column_name
 
 // Do a projection for each of a list of handles
 ValueDicts *DbRelation::project(Handles *handles, const ValueDict *where) {
+    prefetch(handles);
     ColumnNames t;
     for (auto const &column: *where)
         t.push_back(column.first);
@@ -98,3 +186,39 @@ ValueDicts *DbRelation::project(Handles *handles, const ValueDict *where) {
         ret->push_back(project(handle, &t));
     return ret;
 }
+
+// Hand out the next handle of the list
+bool HandlesCursor::next(Handle &handle) {
+    if (this->handles == nullptr || this->position >= this->handles->size())
+        return false;
+    handle = (*this->handles)[this->position++];
+    return true;
+}
+
+// The input rows are freed with the cursor; the where-clause is copied
+FilterCursor::FilterCursor(DbRelation &relation, SelectCursor *input, const ValueDict *where)
+        : relation(relation), input(input), where(), batch(nullptr), position(0) {
+    if (where != nullptr)
+        this->where = *where;
+}
+
+FilterCursor::~FilterCursor() {
+    delete this->batch;
+    delete this->input;
+}
+
+// Get the next row of the input that qualifies, refining another batch of them when need be
+bool FilterCursor::next(Handle &handle) {
+    while (this->batch == nullptr || this->position >= this->batch->size()) {
+        Handles candidates;
+        for (Handle candidate; candidates.size() < BATCH_SIZE && this->input->next(candidate);)
+            candidates.push_back(candidate);
+        if (candidates.empty())
+            return false;
+        delete this->batch;
+        this->batch = this->relation.select(&candidates, &this->where);
+        this->position = 0;
+    }
+    handle = (*this->batch)[this->position++];
+    return true;
+}
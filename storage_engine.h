@@ -9,8 +9,10 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <exception>
 #include <map>
+#include <string>
 #include <utility>
 #include <vector>
 #include "db_cxx.h"
@@ -20,6 +22,8 @@
  */
 extern DbEnv *_DB_ENV;
 
+std::string env_path(const std::string &file_name);
+
 /*
  * Convenient aliases for types
  */
@@ -28,16 +32,118 @@ typedef u_int32_t BlockID;
 typedef std::vector<RecordID> RecordIDs;
 typedef std::length_error DbBlockNoRoomError;
 
+/*
+ * How a marshaled row says a TEXT value is kept out of line (see HeapTable): OVERFLOW_MARKER in place of the
+ * value's length prefix, followed by OVERFLOW_POINTER_SZ bytes saying where the value is.
+ */
+const u_int16_t OVERFLOW_MARKER = 0xFFFF;
+const u_int32_t OVERFLOW_POINTER_SZ = sizeof(u_int32_t) + sizeof(BlockID) + sizeof(RecordID);
+
+/**
+ * @class RecordView - non-owning view of a record's bytes inside a DbBlock.
+ * Only valid as long as the block it came from is alive and unmodified.
+ */
+class RecordView {
+public:
+    RecordView() : data(nullptr), size(0) {}
+
+    RecordView(const void *data, u_int32_t size) : data((const char *) data), size(size) {}
+
+    const char *get_data() const { return data; }
+
+    u_int32_t get_size() const { return size; }
+
+    bool is_null() const { return data == nullptr; }
+
+private:
+    const char *data;
+    u_int32_t size;
+};
+
+class RecordIDRange;
+
+/**
+ * @class BlockPin - whatever is holding a DbBlock's memory in place for it (e.g., a buffer pool frame).
+ * Told when the block's memory has been changed and when the DbBlock is done with it.
+ */
+class BlockPin {
+public:
+    virtual ~BlockPin() {}
+
+    /**
+     * The block's memory has changed and has to be written back to its file.
+     */
+    virtual void mark_dirty() = 0;
+
+    /**
+     * The DbBlock is gone, so the memory can go too.
+     */
+    virtual void unpin() = 0;
+};
+
+/**
+ * @class HeaderField - a 2-byte field of a block's header that lives right in the block's memory rather than in
+ * the DbBlock, so any number of DbBlocks over the same memory (e.g., the same buffer pool frame) always agree.
+ * Reads and writes like a u_int16_t.
+ */
+class HeaderField {
+public:
+    explicit HeaderField(void *address) : address((u_int16_t *) address) {}
+
+    HeaderField(const HeaderField &other) = delete;
+
+    operator u_int16_t() const { return *address; }
+
+    HeaderField &operator=(const HeaderField &other) { return *this = (u_int16_t) other; }
+
+    HeaderField &operator=(u_int16_t n) {
+        *address = n;
+        return *this;
+    }
+
+    HeaderField &operator+=(u_int16_t n) { return *this = (u_int16_t) (*address + n); }
+
+    HeaderField &operator-=(u_int16_t n) { return *this = (u_int16_t) (*address - n); }
+
+    HeaderField &operator++() { return *this += 1; }
+
+    u_int16_t operator++(int) {
+        u_int16_t n = *address;
+        *this += 1;
+        return n;
+    }
+
+    u_int16_t operator--(int) {
+        u_int16_t n = *address;
+        *this -= 1;
+        return n;
+    }
+
+    /**
+     * Look at the same field in another block's memory (for copying the DbBlock it belongs to).
+     * @param address  where the field is in that block
+     */
+    void point_at(void *address) { this->address = (u_int16_t *) address; }
+
+private:
+    u_int16_t *address;
+};
+
 /**
  * @class DbBlock - abstract base class for blocks in our database files 
  * (DbBlock's belong to DbFile's.)
  * 
  * Methods for putting/getting records in blocks:
  * 	add(data)
+ * 	add_batch(records, count, record_ids)
  * 	get(record_id)
+ * 	view(record_id)
  * 	put(record_id, data)
  * 	del(record_id)
+ * 	forward(record_id, to_block_id, to_record_id)
+ * 	get_forward(record_id, to_block_id, to_record_id)
  * 	ids()
+ * 	live_ids()
  * Accessors:
  * 	get_block()
  * 	get_data()
@@ -46,16 +152,33 @@ typedef std::length_error DbBlockNoRoomError;
 class DbBlock {
 public:
     /**
-     * our blocks are 4kB
+     * our blocks are 4kB unless a DbFile is created with some other size
      */
     static const uint BLOCK_SZ = 4096;
 
+    /**
+     * range of block sizes a DbFile can be created with (must also be a power of two)
+     */
+    static const uint MIN_BLOCK_SZ = 4096;
+    static const uint MAX_BLOCK_SZ = 65536;
+
     /**
      * ctor/dtor (subclasses should handle the big-5)
      */
-    DbBlock(Dbt &block, BlockID block_id, bool is_new = false) : block(block), block_id(block_id) {}
+    DbBlock(Dbt &block, BlockID block_id, bool is_new = false) : block(block), block_id(block_id), pin(nullptr) {}
 
-    virtual ~DbBlock() {}
+    DbBlock(const DbBlock &other) : block(other.block), block_id(other.block_id), pin(nullptr) {}
+
+    DbBlock &operator=(const DbBlock &other) {
+        block = other.block;
+        block_id = other.block_id;
+        return *this;  // a block's pin stays with it and is never copied
+    }
+
+    virtual ~DbBlock() {
+        if (pin != nullptr)
+            pin->unpin();
+    }
 
     /**
      * Add a new record to this block.
@@ -65,6 +188,15 @@ public:
      */
     virtual RecordID add(const Dbt *data) = 0;
 
+    /**
+     * Add as many of the given records to this block as will fit, in order.
+     * @param records     the data to store, one Dbt per record
+     * @param count       number of records
+     * @param record_ids  the RecordIDs of the records that were added get appended to this
+     * @returns           how many were added (stops at the first one that doesn't fit)
+     */
+    virtual u_int32_t add_batch(const Dbt *records, u_int32_t count, RecordIDs &record_ids);
+
     /**
      * Get a record from this block.
      * @param record_id  which record to fetch
@@ -72,6 +204,13 @@ public:
      */
     virtual Dbt *get(RecordID record_id) const = 0;
 
+    /**
+     * Look at a record in this block without copying or allocating anything.
+     * @param record_id  which record to look at
+     * @returns          view into the block's memory (is_null() if the record has been deleted)
+     */
+    virtual RecordView view(RecordID record_id) const = 0;
+
     /**
      * Change the data stored for a record in this block.
      * @param record_id  which record to update
@@ -87,12 +226,49 @@ public:
      */
     virtual void del(RecordID record_id) = 0;
 
+    /**
+     * Replace a record with a forwarding stub that says where the record has been moved to.
+     * The record id stays in use (and shows up in ids()) until the stub is deleted or put() over.
+     * @param record_id     which record has been moved
+     * @param to_block_id   block it was moved to (in whatever file the caller keeps moved records)
+     * @param to_record_id  its record id in that block
+     * @throws              DbBlockNoRoomError if there isn't even room for the stub
+     */
+    virtual void forward(RecordID record_id, BlockID to_block_id, RecordID to_record_id) {
+        throw DbBlockNoRoomError("this block cannot hold forwarding stubs");
+    }
+
+    /**
+     * Check if a record is a forwarding stub, and if so where it points.
+     * @param record_id     which record to check
+     * @param to_block_id   set to the block the record was moved to (only if it is a stub)
+     * @param to_record_id  set to its record id in that block (only if it is a stub)
+     * @returns             true if it is a forwarding stub
+     */
+    virtual bool get_forward(RecordID record_id, BlockID &to_block_id, RecordID &to_record_id) const {
+        return false;
+    }
+
     /**
      * Get all the record ids in this block (excluding deleted ones).
      * @returns  pointer to list of record ids (freed by caller)
      */
     virtual RecordIDs *ids() const = 0;
 
+    /**
+     * Get the next record id in this block after the given one (excluding deleted ones).
+     * @param record_id  id to start after (0 to get the first one)
+     * @returns          the next record id, or 0 if there are no more
+     */
+    virtual RecordID next_id(RecordID record_id) const = 0;
+
+    /**
+     * Iterate over all the record ids in this block (excluding deleted ones) without allocating, e.g.:
+     *     for (RecordID record_id : block->live_ids()) ...
+     * @returns  range of record ids
+     */
+    RecordIDRange live_ids() const;
+
     /**
      * Delete all the records from this block.
      */
@@ -122,19 +298,139 @@ public:
      */
     virtual void *get_data() { return block.get_data(); }
 
+    /**
+     * Get the size of this block in bytes (set by the DbFile it belongs to).
+     * @returns  number of bytes in the block
+     */
+    virtual u_int32_t get_block_size() const { return block.get_size(); }
+
     /**
      * Get this block's BlockID within its DbFile.
      * @returns this block's id
      */
     virtual BlockID get_block_id() { return block_id; }
 
+    /**
+     * Get what is holding this block's memory in place.
+     * @returns  the pin, or nullptr if the memory is not being managed for this block
+     */
+    virtual BlockPin *get_pin() const { return pin; }
+
+    /**
+     * Hand this block the pin on its memory, to be unpinned when the block is deleted.
+     * @param pin  the pin
+     */
+    virtual void set_pin(BlockPin *pin) { this->pin = pin; }
+
 protected:
     Dbt block;
     BlockID block_id;
+    BlockPin *pin;
 };
 
+/**
+ * @class RecordIDIterator - forward iterator over the undeleted record ids in a DbBlock
+ */
+class RecordIDIterator {
+public:
+    RecordIDIterator(const DbBlock *block, RecordID record_id) : block(block), record_id(record_id) {}
+
+    RecordID operator*() const { return record_id; }
+
+    RecordIDIterator &operator++() {
+        record_id = block->next_id(record_id);
+        return *this;
+    }
+
+    bool operator==(const RecordIDIterator &other) const { return record_id == other.record_id; }
+
+    bool operator!=(const RecordIDIterator &other) const { return record_id != other.record_id; }
+
+private:
+    const DbBlock *block;
+    RecordID record_id;
+};
+
+/**
+ * @class RecordIDRange - the undeleted record ids in a DbBlock, for use in range-based for loops
+ */
+class RecordIDRange {
+public:
+    explicit RecordIDRange(const DbBlock *block) : block(block) {}
+
+    RecordIDIterator begin() const { return RecordIDIterator(block, block->next_id(0)); }
+
+    RecordIDIterator end() const { return RecordIDIterator(block, 0); }
+
+private:
+    const DbBlock *block;
+};
+
+inline RecordIDRange DbBlock::live_ids() const {
+    return RecordIDRange(this);
+}
+
 // convenience type alias
-typedef std::vector<BlockID> BlockIDs;  // FIXME: will need to turn this into an iterator at some point
+typedef std::vector<BlockID> BlockIDs;
+
+/**
+ * @class BlockIDIterator - forward iterator over a run of block ids
+ */
+class BlockIDIterator {
+public:
+    explicit BlockIDIterator(BlockID block_id) : block_id(block_id) {}
+
+    BlockID operator*() const { return block_id; }
+
+    BlockIDIterator &operator++() {
+        block_id++;
+        return *this;
+    }
+
+    bool operator==(const BlockIDIterator &other) const { return block_id == other.block_id; }
+
+    bool operator!=(const BlockIDIterator &other) const { return block_id != other.block_id; }
+
+private:
+    BlockID block_id;
+};
+
+/**
+ * @class BlockIDRange - the block ids from first to last, for use in range-based for loops.
+ * Takes no memory for the ids themselves, and can be split up to hand pieces of a scan out to workers.
+ */
+class BlockIDRange {
+public:
+    BlockIDRange(BlockID first, BlockID last) : first(first), last(last) {}
+
+    BlockIDIterator begin() const { return BlockIDIterator(first); }
+
+    BlockIDIterator end() const { return BlockIDIterator(empty() ? first : last + 1); }
+
+    BlockID get_first() const { return first; }
+
+    BlockID get_last() const { return last; }
+
+    bool empty() const { return last < first; }
+
+    u_int32_t size() const { return empty() ? 0 : last - first + 1; }
+
+    /**
+     * The part of this range that is also in first..last.
+     * @param first  first block id wanted
+     * @param last   last block id wanted
+     * @return       the overlap (maybe empty)
+     */
+    BlockIDRange subrange(BlockID first, BlockID last) const {
+        return BlockIDRange(std::max(first, this->first), std::min(last, this->last));
+    }
+
+    std::vector<BlockIDRange> split(u_int32_t parts) const;
+
+private:
+    BlockID first;
+    BlockID last;
+};
 
 /**
  * @class DbFile - abstract base class which represents a disk-based collection of DbBlocks
@@ -194,11 +490,31 @@ public:
     virtual void put(DbBlock *block) = 0;
 
     /**
-     * Get a list of all the valid BlockID's in the file
-     * FIXME - not a good long-term approach, but we'll do this until we put in iterators
-     * @returns  a pointer to vector of BlockIDs (freed by caller)
+     * Get all the valid BlockID's in the file
+     * @returns  the range of block ids
      */
-    virtual BlockIDs *block_ids() const = 0;
+    virtual BlockIDRange block_ids() const = 0;
+
+    /**
+     * Get the valid BlockID's in the file from first to last
+     * @param first  first block id wanted
+     * @param last   last block id wanted
+     * @returns      the range of block ids (empty if none of them are in the file)
+     */
+    virtual BlockIDRange block_ids(BlockID first, BlockID last) const { return block_ids().subrange(first, last); }
+
+    /**
+     * Say that some blocks are going to be wanted soon, so the file can start reading them in without
+     * waiting for them. Does nothing unless the file has some way to do that.
+     * @param range  the blocks
+     */
+    virtual void prefetch(BlockIDRange range) {}
+
+    /**
+     * Say that some blocks are going to be wanted soon (in any order).
+     * @param block_ids  the blocks
+     */
+    virtual void prefetch(const BlockIDs &block_ids) {}
 
 protected:
     std::string name;  // filename (or part of it)
@@ -258,9 +574,11 @@ typedef std::string Identifier;
 typedef std::vector<Identifier> ColumnNames;
 typedef std::vector<ColumnAttribute> ColumnAttributes;
 typedef std::pair<BlockID, RecordID> Handle;
-typedef std::vector<Handle> Handles;  // FIXME: will need to turn this into an iterator at some point
+typedef std::vector<Handle> Handles;  // see SelectCursor for going through rows without a list of them
 typedef std::map<Identifier, Value> ValueDict;
 typedef std::vector<ValueDict *> ValueDicts;
+typedef std::vector<uint> ColumnOrdinals;  // positions of some of a relation's columns in its column_names
+typedef std::vector<Value> Row;  // values of a row by position, in the order of the ColumnOrdinals it was projected for
 
 
 /**
@@ -272,6 +590,35 @@ public:
 };
 
 
+/**
+ * @class SelectCursor - the rows of a selection, found as they are asked for rather than all up front as with
+ * DbRelation::select(), so there is no list of handles to hold and the caller can stop early, e.g.:
+ *     SelectCursor *cursor = table.select_cursor(where);
+ *     for (Handle handle; cursor->next(handle);) { ... }
+ *     delete cursor;
+ * The relation must stay open until the cursor is freed.
+ */
+class SelectCursor {
+public:
+    virtual ~SelectCursor() {}
+
+    /**
+     * Get the next qualifying row.
+     * @param handle  set to the row
+     * @returns       false once there are no more
+     */
+    virtual bool next(Handle &handle) = 0;
+
+    /**
+     * Project the row next() just found, if the cursor can do it more cheaply than the relation's
+     * project_row(handle, columns) (e.g., from a block it already has).
+     * @param columns  which columns to project, from the relation's get_column_ordinals()
+     * @returns        the row's values in that order (freed by caller), or nullptr to use project_row()
+     */
+    virtual Row *project_row(const ColumnOrdinals &columns) { return nullptr; }
+};
+
+
 /**
  * @class DbRelation - top-level object handling a physical database relation
  * 
@@ -282,6 +629,7 @@ public:
  * 	
  * 	open()
  * 	close()
+ * 	flush()
  * 	
  *	insert(row)
  *	update(handle, new_values)
@@ -290,6 +638,7 @@ public:
  *	select(where)
  *	project(handle)
  *	project(handle, column_names)
+ *	project_row(handle, columns)
  */
 class DbRelation {
 public:
@@ -328,6 +677,11 @@ public:
      */
     virtual void close() = 0;
 
+    /**
+     * Write out any of the table's changes that are still only in memory (the table stays open).
+     */
+    virtual void flush() {}
+
     /**
      * Execute: INSERT INTO <table_name> ( <row_keys> ) VALUES ( <row_values> )
      * @param row  a dictionary keyed by column names
@@ -374,6 +728,22 @@ public:
      */
     virtual Handles *select(Handles *current_selection, const ValueDict *where) = 0;
 
+    /**
+     * Like select(where), but finds the rows as they are asked for. By default this just makes the whole
+     * list with select() and hands it out a row at a time; relations that can scan lazily should do better.
+     * @param where  where-clause predicates (copied), or nullptr for all the rows
+     * @returns      the rows (freed by caller)
+     */
+    virtual SelectCursor *select_cursor(const ValueDict *where);
+
+    /**
+     * Like select(current_selection, where), but refines the rows of another cursor as they are asked for.
+     * @param current_selection  restrict selection to be from these rows (freed along with the new cursor)
+     * @param where              where-clause predicates (copied)
+     * @returns                  the rows (freed by caller)
+     */
+    virtual SelectCursor *select_cursor(SelectCursor *current_selection, const ValueDict *where);
+
     /**
      * Return a sequence of all values for handle (SELECT *).
      * @param handle  row to get values from
@@ -399,7 +769,23 @@ public:
      */
     virtual ValueDict *project(Handle handle, const ValueDict *column_names);
 
-    // additional versions of project for multiple rows
+    /**
+     * Return the values for handle of the given columns, by position. Cheaper than the dictionary forms of
+     * project() when the column names can be looked up once with get_column_ordinals() for many rows.
+     * By default, picks them out of project(handle).
+     * @param handle   row to get values from
+     * @param columns  which columns, from get_column_ordinals()
+     * @return         the row's values in the order of columns (freed by caller)
+     */
+    virtual Row *project_row(Handle handle, const ColumnOrdinals &columns);
+
+    /**
+     * Say that some rows are going to be wanted soon (see DbFile::prefetch). Does nothing by default.
+     * @param handles  the rows
+     */
+    virtual void prefetch(const Handles *handles) {}
+
+    // additional versions of project for multiple rows (these prefetch the rows first)
     virtual ValueDicts *project(Handles *handles);
 
     virtual ValueDicts *project(Handles *handles, const ColumnNames *column_names);
@@ -431,6 +817,21 @@ public:
      */
     virtual ColumnAttributes *get_column_attributes(const ColumnNames &select_column_names) const;
 
+    /**
+     * Look up where some columns are in column_names, for project_row().
+     * @param select_column_names  list of column names
+     * @returns                    their positions, in the same order (freed by caller)
+     */
+    virtual ColumnOrdinals *get_column_ordinals(const ColumnNames &select_column_names) const;
+
+    /**
+     * Put a row's values back together with their column names.
+     * @param row      values from project_row()
+     * @param columns  the columns they were projected for
+     * @returns        dictionary of the values keyed by column name (freed by caller)
+     */
+    virtual ValueDict *to_value_dict(const Row &row, const ColumnOrdinals &columns) const;
+
     /**
      * Accessor method for table_name
      * @returns  table_name
@@ -445,6 +846,52 @@ protected:
     ColumnAttributes column_attributes;
 };
 
+/**
+ * @class HandlesCursor - SelectCursor handing out a list of handles that is already made
+ */
+class HandlesCursor : public SelectCursor {
+public:
+    explicit HandlesCursor(Handles *handles) : handles(handles), position(0) {}
+
+    virtual ~HandlesCursor() { delete handles; }
+
+    HandlesCursor(const HandlesCursor &other) = delete;
+
+    HandlesCursor &operator=(const HandlesCursor &other) = delete;
+
+    virtual bool next(Handle &handle);
+
+protected:
+    Handles *handles;  // freed with the cursor (nullptr for none)
+    size_t position;
+};
+
+/**
+ * @class FilterCursor - SelectCursor refining the rows of another one with DbRelation::select(current_selection,
+ * where), BATCH_SIZE rows at a time
+ */
+class FilterCursor : public SelectCursor {
+public:
+    FilterCursor(DbRelation &relation, SelectCursor *input, const ValueDict *where);
+
+    virtual ~FilterCursor();
+
+    FilterCursor(const FilterCursor &other) = delete;
+
+    FilterCursor &operator=(const FilterCursor &other) = delete;
+
+    virtual bool next(Handle &handle);
+
+    static const size_t BATCH_SIZE = 256;
+
+protected:
+    DbRelation &relation;
+    SelectCursor *input;  // freed with the cursor
+    ValueDict where;
+    Handles *batch;       // rows of the last batch that qualified (or nullptr)
+    size_t position;
+};
+
 
 class DbIndex {
 public:
@@ -481,6 +928,11 @@ public:
      */
     virtual void close() = 0;
 
+    /**
+     * Write out any of the index's changes that are still only in memory (the index stays open).
+     */
+    virtual void flush() {}
+
     /**
      * Lookup a specific search key.
      * @param key_values  dictionary of values for the search key